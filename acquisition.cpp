@@ -0,0 +1,191 @@
+#include "acquisition.h"
+#include <cmath>
+#include <algorithm>
+
+static int wrapBin(int k) {
+    return (k % CARRIER_FFT_SIZE + CARRIER_FFT_SIZE) % CARRIER_FFT_SIZE;
+}
+
+CarrierDetector::CarrierDetector(double sampleRate, double loFreq, double hiFreq) : fft(CARRIER_FFT_SIZE) {
+    this->sampleRate = sampleRate;
+    window.resize(CARRIER_FFT_SIZE);
+    for(int i = 0; i < CARRIER_FFT_SIZE; i++) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / (CARRIER_FFT_SIZE - 1));
+    }
+    passband.assign(CARRIER_FFT_SIZE, false);
+    for(int k = (int)std::floor((loFreq - CARRIER_MARGIN) * CARRIER_FFT_SIZE / sampleRate); k <= (int)std::ceil((hiFreq + CARRIER_MARGIN) * CARRIER_FFT_SIZE / sampleRate); k++) {
+        if(std::abs(k) < CARRIER_FFT_SIZE / 2) {
+            passband[wrapBin(k)] = true;
+        }
+    }
+    for(int k = (int)std::ceil(2 * loFreq * CARRIER_FFT_SIZE / sampleRate); k <= (int)std::floor(2 * hiFreq * CARRIER_FFT_SIZE / sampleRate); k++) {
+        if(std::abs(k) < CARRIER_FFT_SIZE / 2) {
+            lineBins.push_back(k);
+        }
+    }
+    power.assign(lineBins.size(), 0.0);
+    spectrum.resize(CARRIER_FFT_SIZE);
+    windows = 0;
+}
+
+bool CarrierDetector::isValid() {
+    return lineBins.size() >= 3;
+}
+
+void CarrierDetector::addWindow(const std::complex<double>* samples) {
+    for(int i = 0; i < CARRIER_FFT_SIZE; i++) {
+        spectrum[i] = samples[i] * window[i];
+    }
+    fft.transform(spectrum.data());
+    //inverse transform of the band as conj(fft(conj(x))), then squared
+    for(int i = 0; i < CARRIER_FFT_SIZE; i++) {
+        spectrum[i] = passband[i] ? std::conj(spectrum[i]) : 0;
+    }
+    fft.transform(spectrum.data());
+    for(int i = 0; i < CARRIER_FFT_SIZE; i++) {
+        spectrum[i] = std::conj(spectrum[i]) * std::conj(spectrum[i]);
+    }
+    fft.transform(spectrum.data());
+    for(size_t k = 0; k < lineBins.size(); k++) {
+        power[k] += std::norm(spectrum[wrapBin(lineBins[k])]);
+    }
+    windows++;
+}
+
+int CarrierDetector::getWindows() {
+    return windows;
+}
+
+bool CarrierDetector::getPeak(double* freq, double* ratioDb) {
+    if(windows == 0 || !isValid()) {
+        return false;
+    }
+    std::vector<double> sorted = power;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    double median = sorted[sorted.size() / 2];
+    int peak = std::max_element(power.begin(), power.end()) - power.begin();
+    //parabolic interpolation between the neighbour bins
+    double offset = 0;
+    if(peak > 0 && peak < (int)power.size() - 1) {
+        double a = power[peak - 1];
+        double b = power[peak];
+        double c = power[peak + 1];
+        double denominator = a - 2 * b + c;
+        if(denominator != 0) {
+            offset = 0.5 * (a - c) / denominator;
+        }
+    }
+    *freq = (lineBins[peak] + offset) * sampleRate / CARRIER_FFT_SIZE / 2;
+    *ratioDb = median > 0 ? 10 * std::log10(power[peak] / median) : 0;
+    return true;
+}
+
+void CarrierDetector::reset() {
+    std::fill(power.begin(), power.end(), 0.0);
+    windows = 0;
+}
+
+static int discoveryFftSize(double sampleRate) {
+    int size = 64;
+    while(size < DISCOVERY_MAX_FFT_SIZE && sampleRate / size > DISCOVERY_BIN_WIDTH) {
+        size *= 2;
+    }
+    return size;
+}
+
+WidebandCarrierDetector::WidebandCarrierDetector(double sampleRate, double thresholdDb, double edgeFreq) : fft(discoveryFftSize(sampleRate)) {
+    this->sampleRate = sampleRate;
+    threshold = std::pow(10, thresholdDb / 10);
+    this->edgeFreq = edgeFreq;
+    size = fft.getSize();
+    window.resize(size);
+    for(int i = 0; i < size; i++) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / (size - 1));
+    }
+    spectrum.resize(size);
+    power.assign(size, 0.0);
+    filled = 0;
+    skip = 0;
+    interval = std::max((long long)size, (long long)(sampleRate / DISCOVERY_WINDOWS_PER_SECOND));
+    windows = 0;
+}
+
+bool WidebandCarrierDetector::process(const std::complex<double>* samples, int count) {
+    bool evaluated = false;
+    int pos = 0;
+    while(pos < count) {
+        if(skip > 0) {
+            int n = (int)std::min(skip, (long long)(count - pos));
+            skip -= n;
+            pos += n;
+            continue;
+        }
+        int n = std::min(size - filled, count - pos);
+        for(int i = 0; i < n; i++) {
+            spectrum[filled + i] = samples[pos + i] * window[filled + i];
+        }
+        filled += n;
+        pos += n;
+        if(filled < size) {
+            break;
+        }
+        fft.transform(spectrum.data());
+        for(int i = 0; i < size; i++) {
+            power[i] += std::norm(spectrum[(i + size / 2) % size]);
+        }
+        filled = 0;
+        skip = interval - size;
+        if(++windows == DISCOVERY_WINDOWS_PER_SECOND) {
+            evaluate();
+            std::fill(power.begin(), power.end(), 0.0);
+            windows = 0;
+            evaluated = true;
+        }
+    }
+    return evaluated;
+}
+
+void WidebandCarrierDetector::evaluate() {
+    carriers.clear();
+    std::vector<double> sorted = power;
+    std::nth_element(sorted.begin(), sorted.begin() + size / 2, sorted.end());
+    double median = sorted[size / 2];
+    if(median <= 0) {
+        return;
+    }
+    double binWidth = sampleRate / size;
+    int i = 0;
+    while(i < size) {
+        if(power[i] < median * threshold) {
+            i++;
+            continue;
+        }
+        //run of bins over the threshold, single bins under it are bridged
+        int start = i;
+        int end = i;
+        while(end + 1 < size && (power[end + 1] >= median * threshold || (end + 2 < size && power[end + 2] >= median * threshold))) {
+            end++;
+        }
+        i = end + 1;
+        double width = (end - start + 1) * binWidth;
+        if(width < DISCOVERY_MIN_WIDTH || width > DISCOVERY_MAX_WIDTH) {
+            continue;
+        }
+        //bpsk spectrum is symmetric, so the centroid is the carrier
+        double sum = 0;
+        double weighted = 0;
+        for(int k = start; k <= end; k++) {
+            double excess = power[k] - median;
+            sum += excess;
+            weighted += excess * k;
+        }
+        double freq = (weighted / sum - size / 2) * binWidth;
+        if(std::fabs(freq) <= edgeFreq) {
+            carriers.push_back(freq);
+        }
+    }
+}
+
+std::vector<double> WidebandCarrierDetector::getCarriers() {
+    return carriers;
+}
@@ -0,0 +1,79 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+#include "fft.h"
+
+#define CARRIER_FFT_SIZE 4096
+//bandwidth added on both sides of the searched band for the modulation
+#define CARRIER_MARGIN 1200
+//line height over the median of the squared spectrum in dB
+#define CARRIER_DEFAULT_THRESHOLD 8
+
+//finds bpsk carrier between loFreq and hiFreq: the band is cut out(positive side only) and squared, which leaves a line at twice the carrier frequency regardless of the data
+//power spectra of the windows are averaged until reset()
+class CarrierDetector {
+public:
+    CarrierDetector(double sampleRate, double loFreq, double hiFreq);
+    //false if the band is too narrow for the fft resolution
+    bool isValid();
+    //adds one window of CARRIER_FFT_SIZE samples
+    void addWindow(const std::complex<double>* samples);
+    int getWindows();
+    //carrier frequency estimate and its line over the median in dB; false if nothing was added
+    bool getPeak(double* freq, double* ratioDb);
+    void reset();
+private:
+    double sampleRate;
+    Fft fft;
+    std::vector<double> window;
+    std::vector<bool> passband;
+    //signed fft bins of the doubled band
+    std::vector<int> lineBins;
+    std::vector<double> power;
+    std::vector<std::complex<double>> spectrum;
+    int windows;
+};
+
+//fft bins of the wideband spectrum are not wider than this, Hz
+#define DISCOVERY_BIN_WIDTH 300
+#define DISCOVERY_MAX_FFT_SIZE 65536
+//spectrum of the wideband input is sampled with this count of windows per second and evaluated every second
+#define DISCOVERY_WINDOWS_PER_SECOND 16
+//bins over the median in dB
+#define DISCOVERY_DEFAULT_THRESHOLD 6
+//width of the bins over the threshold for 1200 baud bpsk(main lobe is 2400 Hz)
+#define DISCOVERY_MIN_WIDTH 600
+#define DISCOVERY_MAX_WIDTH 4000
+
+//finds bpsk carriers in the whole band of the iq input by their width in the averaged power spectrum
+//only one fft window is taken from every 1/16 s of the input, so the cost doesn't depend on the count of carriers
+class WidebandCarrierDetector {
+public:
+    //carriers further than edgeFreq from the center are ignored
+    WidebandCarrierDetector(double sampleRate, double thresholdDb, double edgeFreq);
+    //returns true when the spectrum of the last second was evaluated and getCarriers() is updated
+    bool process(const std::complex<double>* samples, int count);
+    //frequencies relative to the center of the input
+    std::vector<double> getCarriers();
+private:
+    void evaluate();
+    double sampleRate;
+    double threshold;
+    double edgeFreq;
+    int size;
+    Fft fft;
+    std::vector<double> window;
+    std::vector<std::complex<double>> spectrum;
+    //fft bins from -rate/2 to rate/2
+    std::vector<double> power;
+    int filled;
+    long long skip;
+    long long interval;
+    int windows;
+    std::vector<double> carriers;
+};
+
+#endif // ACQUISITION_H
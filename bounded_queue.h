@@ -0,0 +1,64 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//blocking fifo with limited capacity to connect processing threads
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) {
+        this->capacity = capacity;
+        closed = false;
+    }
+
+    //blocks while the queue is full; returns false if the queue was closed
+    bool push(const T& item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if(closed) {
+            return false;
+        }
+        items.push_back(item);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    //blocks while the queue is empty; returns false if the queue was closed and nothing is left
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if(items.empty()) {
+            return false;
+        }
+        item = items.front();
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    //wakes up all waiting threads; remaining items still can be popped
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,144 @@
+#include "capture_ring.h"
+#include <audiofile.h>
+#include <iostream>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+CaptureRing::CaptureRing(double seconds, std::string prefix) {
+    this->seconds = seconds;
+    this->prefix = prefix;
+    sampleRate = 0;
+    channels = 0;
+    blockSize = 0;
+    head = 0;
+    fill = 0;
+    wrapped = false;
+    hasTriggered = false;
+    stopping = false;
+}
+
+CaptureRing::~CaptureRing() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    jobsCv.notify_all();
+    if(writer.joinable()) {
+        writer.join();
+    }
+}
+
+void CaptureRing::start(double sampleRate, int channels) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+    blockSize = (size_t)(sampleRate * CAPTURE_BLOCK_SECONDS) * channels;
+    //one more block for the partially filled newest one, so the full time is always kept
+    int blocks = (int)std::ceil(seconds / CAPTURE_BLOCK_SECONDS) + 1;
+    ring.clear();
+    for(int i = 0; i < blocks; i++) {
+        ring.push_back(block(new std::vector<int16_t>(blockSize)));
+    }
+    head = 0;
+    fill = 0;
+    wrapped = false;
+    if(!writer.joinable()) {
+        writer = std::thread(&CaptureRing::writerLoop, this);
+    }
+}
+
+void CaptureRing::push(const std::complex<double>* samples, int count) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(ring.empty()) {
+        return;
+    }
+    for(int i = 0; i < count; i++) {
+        if(fill == blockSize) {
+            head = (head + 1) % ring.size();
+            wrapped = wrapped || head == 0;
+            //the old block is still being written to a file
+            if(ring[head].use_count() > 1) {
+                ring[head] = block(new std::vector<int16_t>(blockSize));
+            }
+            fill = 0;
+        }
+        int16_t* dst = ring[head]->data() + fill;
+        dst[0] = (int16_t)std::max(-32768.0, std::min(32767.0, std::round(samples[i].real())));
+        if(channels == 2) {
+            dst[1] = (int16_t)std::max(-32768.0, std::min(32767.0, std::round(samples[i].imag())));
+        }
+        fill += channels;
+    }
+}
+
+bool CaptureRing::trigger(std::string reason) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    dumpJob job;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(ring.empty() || (hasTriggered && now - lastTrigger < std::chrono::seconds(CAPTURE_MIN_INTERVAL))) {
+            return false;
+        }
+        hasTriggered = true;
+        lastTrigger = now;
+        //oldest block first
+        int size = ring.size();
+        for(int i = wrapped ? 1 : size - head; i <= size; i++) {
+            job.blocks.push_back(ring[(head + i) % size]);
+        }
+        job.lastFill = fill;
+        char time[32];
+        std::time_t t = std::time(nullptr);
+        std::strftime(time, sizeof(time), "%Y%m%d_%H%M%S", std::gmtime(&t));
+        job.path = prefix + "_" + time + "_" + reason + ".wav";
+        std::cout << "capture: " << reason << ", writing " << job.path << std::endl;
+        jobs.push_back(std::move(job));
+    }
+    jobsCv.notify_one();
+    return true;
+}
+
+double CaptureRing::getSizeMb() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return (double)ring.size() * blockSize * sizeof(int16_t) / (1024 * 1024);
+}
+
+void CaptureRing::writerLoop() {
+    while(true) {
+        dumpJob job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            jobsCv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        writeDump(job);
+    }
+}
+
+void CaptureRing::writeDump(dumpJob& job) {
+    AFfilesetup setup = afNewFileSetup();
+    afInitFileFormat(setup, AF_FILE_WAVE);
+    afInitChannels(setup, AF_DEFAULT_TRACK, channels);
+    afInitRate(setup, AF_DEFAULT_TRACK, sampleRate);
+    afInitSampleFormat(setup, AF_DEFAULT_TRACK, AF_SAMPFMT_TWOSCOMP, 16);
+    AFfilehandle file = afOpenFile(job.path.c_str(), "w", setup);
+    afFreeFileSetup(setup);
+    if(file == AF_NULL_FILEHANDLE) {
+        std::cout << "capture: failed to open " << job.path << "!" << std::endl;
+        return;
+    }
+    long long frames = 0;
+    for(size_t i = 0; i < job.blocks.size(); i++) {
+        //the newest block is written only up to the trigger, the demodulator thread keeps filling it
+        size_t values = i + 1 == job.blocks.size() ? job.lastFill : blockSize;
+        afWriteFrames(file, AF_DEFAULT_TRACK, job.blocks[i]->data(), values / channels);
+        frames += values / channels;
+    }
+    afCloseFile(file);
+    std::cout << "capture: " << job.path << " written, " << frames / sampleRate << " s" << std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef CAPTURE_RING_H
+#define CAPTURE_RING_H
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+//ring is kept in blocks of this length, seconds
+#define CAPTURE_BLOCK_SECONDS 1
+#define CAPTURE_DEFAULT_SECONDS 300
+//triggers after a dump are ignored for this time, so the flapping sync doesn't fill the disk, seconds
+#define CAPTURE_MIN_INTERVAL 60
+
+//the last seconds of the raw input kept in memory as 16 bit samples, dumped to a wav file on trigger
+//trigger only takes references to the blocks, the file is written by a background thread; blocks still held by
+//a dump are not overwritten but replaced with new ones, so the demodulator thread never waits for the disk
+class CaptureRing {
+public:
+    //files are named <prefix>_<utc time>_<reason>.wav
+    CaptureRing(double seconds, std::string prefix);
+    //writes the pending dumps
+    ~CaptureRing();
+    //allocates the ring for the input format: 2 channels for iq(i and q), 1 for real samples
+    void start(double sampleRate, int channels);
+    void push(const std::complex<double>* samples, int count);
+    //can be called from any thread; returns false if the trigger is ignored(not started or too soon after the last one)
+    bool trigger(std::string reason);
+    //memory of the ring, MB
+    double getSizeMb();
+private:
+    typedef std::shared_ptr<std::vector<int16_t>> block;
+    struct dumpJob {
+        std::string path;
+        std::vector<block> blocks;
+        //values in the last block
+        size_t lastFill;
+    };
+    void writerLoop();
+    void writeDump(dumpJob& job);
+    double seconds;
+    std::string prefix;
+    double sampleRate;
+    int channels;
+    //values(samples * channels) in a block
+    size_t blockSize;
+    std::mutex mtx;
+    std::vector<block> ring;
+    int head;
+    size_t fill;
+    bool wrapped;
+    bool hasTriggered;
+    std::chrono::steady_clock::time_point lastTrigger;
+    std::deque<dumpJob> jobs;
+    std::condition_variable jobsCv;
+    bool stopping;
+    std::thread writer;
+};
+
+#endif // CAPTURE_RING_H
@@ -0,0 +1,86 @@
+#include "channelizer.h"
+#include "dsp.h"
+#include <cmath>
+
+Channelizer::Channelizer(int channels) : fft(channels) {
+    this->channels = channels;
+    decimation = channels / 2;
+    taps = designLowpass(channels * CHANNELIZER_TAPS_PER_BRANCH, CHANNELIZER_CUTOFF / channels);
+    rotation.resize(channels);
+    for(int i = 0; i < channels; i++) {
+        rotation[i] = std::polar(1.0, -2 * M_PI * i / channels);
+    }
+    work.assign(taps.size() - 1, std::complex<double>(0, 0));
+    branches.resize(channels);
+    active.assign(channels, false);
+    outputs.resize(channels);
+    skip = decimation;
+    time = 0;
+}
+
+void Channelizer::setActive(int channel, bool active) {
+    this->active[channel] = active;
+    if(!active) {
+        std::vector<std::complex<double>>().swap(outputs[channel]);
+    }
+}
+
+bool Channelizer::isActive(int channel) {
+    return active[channel];
+}
+
+int Channelizer::process(const std::complex<double>* in, int count) {
+    int history = taps.size() - 1;
+    work.resize(history);
+    work.insert(work.end(), in, in + count);
+    int maxOutputs = count / decimation + 1;
+    for(int k = 0; k < channels; k++) {
+        if(active[k] && (int)outputs[k].size() < maxOutputs) {
+            outputs[k].resize(maxOutputs);
+        }
+    }
+    int produced = 0;
+    int i = skip - 1;
+    for(; i < count; i += decimation) {
+        //channel k is the input mixed down by k*rate/channels and lowpass filtered:
+        //y_k[t] = exp(-j*2pi*k*t/M) * sum_r exp(j*2pi*k*r/M) * sum_p h[r+M*p]*x[t-r-M*p]
+        const std::complex<double>* newest = work.data() + history + i;
+        for(int r = 0; r < channels; r++) {
+            std::complex<double> acc(0, 0);
+            const double* h = taps.data() + r;
+            const std::complex<double>* x = newest - r;
+            for(int p = 0; p < CHANNELIZER_TAPS_PER_BRANCH; p++) {
+                acc += h[p * channels] * x[-p * channels];
+            }
+            branches[r] = acc;
+        }
+        //forward fft gives exp(+j*2pi*k*r/M) sums at bin -k
+        fft.transform(branches.data());
+        int t = (time + i) % channels;
+        for(int k = 0; k < channels; k++) {
+            if(active[k]) {
+                outputs[k][produced] = branches[(channels - k) % channels] * rotation[(long long)k * t % channels];
+            }
+        }
+        produced++;
+    }
+    skip = i - count + 1;
+    time = (time + count) % channels;
+    work.erase(work.begin(), work.end() - history);
+    return produced;
+}
+
+std::complex<double>* Channelizer::getOutput(int channel) {
+    return outputs[channel].data();
+}
+
+int Channelizer::getChannels() {
+    return channels;
+}
+
+int Channelizer::getChannel(double freq, double sampleRate, double* offset) {
+    double spacing = sampleRate / channels;
+    int index = (int)std::lround(freq / spacing);
+    *offset = freq - index * spacing;
+    return ((index % channels) + channels) % channels;
+}
@@ -0,0 +1,47 @@
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include <complex>
+#include <vector>
+#include "fft.h"
+
+#define CHANNELIZER_MIN_CHANNELS 4
+#define CHANNELIZER_MAX_CHANNELS 4096
+#define CHANNELIZER_TAPS_PER_BRANCH 32
+//cutoff of the prototype lowpass relative to the channel spacing; channels overlap, so carriers between channel centers are not cut
+#define CHANNELIZER_CUTOFF 0.8
+
+//fft polyphase filterbank splitting iq input to channels spaced sampleRate/channels apart
+//outputs are 2x oversampled(2*sampleRate/channels); channel k is centered at k*sampleRate/channels, channels above the half are negative
+//only active channels are stored, the cost per input sample is 2*CHANNELIZER_TAPS_PER_BRANCH + 2*log2(channels) regardless of their count
+class Channelizer {
+public:
+    //channels must be power of 2
+    Channelizer(int channels);
+    void setActive(int channel, bool active);
+    bool isActive(int channel);
+    //filters count input samples; returns count of samples written to getOutput() of each active channel
+    int process(const std::complex<double>* in, int count);
+    //valid until the next process() call, can be modified
+    std::complex<double>* getOutput(int channel);
+    int getChannels();
+    //nearest channel to the frequency(relative to the input center, in sampleRate units) and the offset of the frequency from its center
+    int getChannel(double freq, double sampleRate, double* offset);
+private:
+    int channels;
+    int decimation;
+    Fft fft;
+    std::vector<double> taps;
+    std::vector<std::complex<double>> rotation;
+    //last taps-1 input samples followed by the new ones
+    std::vector<std::complex<double>> work;
+    std::vector<std::complex<double>> branches;
+    std::vector<bool> active;
+    std::vector<std::vector<std::complex<double>>> outputs;
+    //input samples needed for the next output
+    int skip;
+    //index of the next input sample modulo channels
+    int time;
+};
+
+#endif // CHANNELIZER_H
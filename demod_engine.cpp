@@ -0,0 +1,704 @@
+#include "demod_engine.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+//soft decisions with full confidence for engines which give only hard symbols, stdc_demod --soft doesn't take them
+static void appendHardSoft(const std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>& results, std::vector<SoftChunk>* soft) {
+    for(size_t d = 0; d < results.size(); d++) {
+        SoftChunk chunk;
+        for(int i = 0; i < DEMODULATOR_SYMBOLSPERCHUNK; i++) {
+            chunk.symbols[i] = results[d].bitsDemodulated[i] ? SOFT_SYMBOL_MAX : -SOFT_SYMBOL_MAX;
+        }
+        soft->push_back(chunk);
+    }
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> LibDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod.demodulate(samples, length);
+    if(soft != nullptr) {
+        appendHardSoft(res, soft);
+    }
+    return res;
+}
+
+void LibDemodEngine::setLowFreq(double freq) {
+    demod.setLowFreq(freq);
+}
+
+void LibDemodEngine::setHighFreq(double freq) {
+    demod.setHighFreq(freq);
+}
+
+void LibDemodEngine::setCenterFreq(double freq) {
+    demod.setCenterFreq(freq);
+}
+
+double LibDemodEngine::getCenterFreq() {
+    return demod.getCenterFreq();
+}
+
+bool LibDemodEngine::getIsInSync() {
+    return demod.getIsInSync();
+}
+
+FastDemodEngine::FastDemodEngine(double sampleRate, double freqOffset) : demod(sampleRate) {
+    this->freqOffset = freqOffset;
+    setLowFreq(FASTDEMOD_DEFAULT_LO_FREQ);
+    setHighFreq(FASTDEMOD_DEFAULT_HI_FREQ);
+    setCenterFreq(FASTDEMOD_DEFAULT_CENTER_FREQ);
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> FastDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    return demod.demodulate(samples, length, soft);
+}
+
+void FastDemodEngine::setLowFreq(double freq) {
+    demod.setLowFreq(freq - freqOffset);
+}
+
+void FastDemodEngine::setHighFreq(double freq) {
+    demod.setHighFreq(freq - freqOffset);
+}
+
+void FastDemodEngine::setCenterFreq(double freq) {
+    demod.setCenterFreq(freq - freqOffset);
+}
+
+double FastDemodEngine::getCenterFreq() {
+    return demod.getCenterFreq() + freqOffset;
+}
+
+bool FastDemodEngine::getIsInSync() {
+    return demod.getIsInSync();
+}
+
+CompareDemodEngine::CompareDemodEngine() {
+    comparedSymbols = 0;
+    matchedSymbols = 0;
+    lastAgreement = 0;
+    lastLag = 0;
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> CompareDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    //fast engine does not modify the input, so it goes first
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> fastRes = fast.demodulate(samples, length);
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> libRes = lib.demodulate(samples, length, soft);
+    for(int d = 0; d < (int)fastRes.size(); d++) {
+        fastSymbols.insert(fastSymbols.end(), fastRes[d].bitsDemodulated, fastRes[d].bitsDemodulated + DEMODULATOR_SYMBOLSPERCHUNK);
+    }
+    for(int d = 0; d < (int)libRes.size(); d++) {
+        libSymbols.insert(libSymbols.end(), libRes[d].bitsDemodulated, libRes[d].bitsDemodulated + DEMODULATOR_SYMBOLSPERCHUNK);
+    }
+    compare();
+    return libRes;
+}
+
+void CompareDemodEngine::compare() {
+    int needed = COMPARE_WINDOW + 2 * COMPARE_MAX_LAG;
+    while((int)libSymbols.size() >= needed && (int)fastSymbols.size() >= needed) {
+        const uint8_t* ref = libSymbols.data() + COMPARE_MAX_LAG;
+        int bestMatches = -1;
+        int bestLag = 0;
+        for(int lag = -COMPARE_MAX_LAG; lag <= COMPARE_MAX_LAG; lag++) {
+            const uint8_t* other = fastSymbols.data() + COMPARE_MAX_LAG + lag;
+            int matches = 0;
+            for(int i = 0; i < COMPARE_WINDOW; i++) {
+                matches += ref[i] == other[i];
+            }
+            //bpsk phase ambiguity: inverted stream is resolved by the decoder
+            if(COMPARE_WINDOW - matches > matches) {
+                matches = COMPARE_WINDOW - matches;
+            }
+            if(matches > bestMatches) {
+                bestMatches = matches;
+                bestLag = lag;
+            }
+        }
+        comparedSymbols += COMPARE_WINDOW;
+        matchedSymbols += bestMatches;
+        lastAgreement = (double)bestMatches / COMPARE_WINDOW;
+        lastLag = bestLag;
+        //drop compared window and follow the delay between engines
+        libSymbols.erase(libSymbols.begin(), libSymbols.begin() + COMPARE_WINDOW);
+        fastSymbols.erase(fastSymbols.begin(), fastSymbols.begin() + COMPARE_WINDOW + bestLag);
+    }
+    //one of the engines produces nothing, keep the other from growing forever
+    int limit = needed * 16;
+    if((int)libSymbols.size() > limit) {
+        libSymbols.erase(libSymbols.begin(), libSymbols.end() - needed);
+    }
+    if((int)fastSymbols.size() > limit) {
+        fastSymbols.erase(fastSymbols.begin(), fastSymbols.end() - needed);
+    }
+}
+
+void CompareDemodEngine::setLowFreq(double freq) {
+    lib.setLowFreq(freq);
+    fast.setLowFreq(freq);
+}
+
+void CompareDemodEngine::setHighFreq(double freq) {
+    lib.setHighFreq(freq);
+    fast.setHighFreq(freq);
+}
+
+void CompareDemodEngine::setCenterFreq(double freq) {
+    lib.setCenterFreq(freq);
+    fast.setCenterFreq(freq);
+}
+
+double CompareDemodEngine::getCenterFreq() {
+    return lib.getCenterFreq();
+}
+
+bool CompareDemodEngine::getIsInSync() {
+    return lib.getIsInSync();
+}
+
+std::string CompareDemodEngine::getStats() {
+    std::ostringstream os;
+    os << " fast freq = " << fast.getCenterFreq() << " fast sync = " << (fast.getIsInSync() ? "true" : "false");
+    if(comparedSymbols > 0) {
+        os << " agreement = " << lastAgreement * 100 << "% (total " << (double)matchedSymbols / comparedSymbols * 100 << "% of " << comparedSymbols << " symbols, lag " << lastLag << ")";
+    }
+    return os.str();
+}
+
+AutoTuneDemodEngine::AutoTuneDemodEngine(DemodEngine* engine, double sampleRate, double freqOffset, double thresholdDb, double bias) {
+    this->engine.reset(engine);
+    this->sampleRate = sampleRate;
+    this->freqOffset = freqOffset;
+    this->thresholdDb = thresholdDb;
+    this->bias = bias;
+    loFreq = FASTDEMOD_DEFAULT_LO_FREQ;
+    hiFreq = FASTDEMOD_DEFAULT_HI_FREQ;
+    window.resize(CARRIER_FFT_SIZE);
+    acquisitions = 0;
+    lastEstimate = 0;
+    lastRatio = 0;
+    startAcquisition();
+}
+
+void AutoTuneDemodEngine::startAcquisition() {
+    if(!detector) {
+        detector.reset(new CarrierDetector(sampleRate, loFreq - freqOffset, hiFreq - freqOffset));
+    }
+    detector->reset();
+    windowPos = 0;
+    stateSamples = 0;
+    state = ACQUIRING;
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> AutoTuneDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    //the library demodulator may change the samples, so they are collected first
+    if(state == ACQUIRING && detector->isValid()) {
+        for(int i = 0; i < length; i++) {
+            window[windowPos++] = samples[i];
+            if(windowPos < CARRIER_FFT_SIZE) {
+                continue;
+            }
+            windowPos = 0;
+            detector->addWindow(window.data());
+            if(detector->getWindows() < AUTOTUNE_WINDOWS) {
+                continue;
+            }
+            double freq, ratioDb;
+            if(detector->getPeak(&freq, &ratioDb) && ratioDb >= thresholdDb) {
+                lastEstimate = freq + freqOffset;
+                lastRatio = ratioDb;
+                acquisitions++;
+                if(std::fabs(engine->getCenterFreq() - (lastEstimate + bias)) >= AUTOTUNE_MIN_CORRECTION) {
+                    engine->setCenterFreq(lastEstimate + bias);
+                }
+                state = WAITING_SYNC;
+                stateSamples = 0;
+                break;
+            }
+            //no carrier yet, start over with new windows
+            detector->reset();
+        }
+    }
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = engine->demodulate(samples, length, soft);
+    bool sync = engine->getIsInSync();
+    stateSamples += length;
+    if(state == ACQUIRING && sync) {
+        //the demodulator found the carrier by itself
+        state = TRACKING;
+        stateSamples = 0;
+    } else if(state == WAITING_SYNC) {
+        if(sync) {
+            state = TRACKING;
+            stateSamples = 0;
+        } else if(stateSamples > AUTOTUNE_SYNC_TIMEOUT * sampleRate) {
+            startAcquisition();
+        }
+    } else if(state == TRACKING) {
+        if(sync) {
+            stateSamples = 0;
+        } else if(stateSamples > AUTOTUNE_LOSS_TIME * sampleRate) {
+            startAcquisition();
+        }
+    }
+    return res;
+}
+
+void AutoTuneDemodEngine::setLowFreq(double freq) {
+    loFreq = freq;
+    detector.reset();
+    startAcquisition();
+    engine->setLowFreq(freq);
+}
+
+void AutoTuneDemodEngine::setHighFreq(double freq) {
+    hiFreq = freq;
+    detector.reset();
+    startAcquisition();
+    engine->setHighFreq(freq);
+}
+
+void AutoTuneDemodEngine::setCenterFreq(double freq) {
+    engine->setCenterFreq(freq);
+}
+
+double AutoTuneDemodEngine::getCenterFreq() {
+    return engine->getCenterFreq();
+}
+
+bool AutoTuneDemodEngine::getIsInSync() {
+    return engine->getIsInSync();
+}
+
+std::string AutoTuneDemodEngine::getStats() {
+    std::ostringstream os;
+    os << engine->getStats() << " acq = " << (state == ACQUIRING ? "searching" : (state == WAITING_SYNC ? "tuned" : "tracking")) << " (" << acquisitions << " estimates";
+    if(acquisitions > 0) {
+        os << ", last " << lastEstimate << " Hz " << lastRatio << " dB";
+    }
+    os << ")";
+    return os.str();
+}
+
+RaceDemodEngine::RaceDemodEngine(std::function<DemodEngine*()> factory, int count, bool copyInput, double sampleRate) : pool(count) {
+    this->factory = factory;
+    this->count = count;
+    this->copyInput = copyInput;
+    this->sampleRate = sampleRate;
+    loFreq = FASTDEMOD_DEFAULT_LO_FREQ;
+    hiFreq = FASTDEMOD_DEFAULT_HI_FREQ;
+    centFreq = FASTDEMOD_DEFAULT_CENTER_FREQ;
+    results.resize(count);
+    softResults.resize(count);
+    copies.resize(count);
+    races = 0;
+    wins = 0;
+    jobSamples = nullptr;
+    jobLength = 0;
+    jobSoft = false;
+    startRace();
+}
+
+void RaceDemodEngine::startRace() {
+    //the last winner keeps its frequency as hypothesis 0, the standby and new ones are spread across the band
+    if(standby) {
+        engines.push_back(std::move(standby));
+    }
+    while((int)engines.size() < count) {
+        engines.push_back(std::unique_ptr<DemodEngine>(factory()));
+    }
+    for(int i = 0; i < count; i++) {
+        engines[i]->setLowFreq(loFreq);
+        engines[i]->setHighFreq(hiFreq);
+        if(i > 0) {
+            engines[i]->setCenterFreq(loFreq + (hiFreq - loFreq) * (i - 0.5) / (count - 1));
+        } else if(races == 0) {
+            engines[i]->setCenterFreq(centFreq);
+        }
+    }
+    racing = true;
+    lostSamples = 0;
+    races++;
+}
+
+void RaceDemodEngine::runHypothesis(int index) {
+    std::complex<double>* input = jobSamples;
+    if(copyInput) {
+        copies[index].assign(jobSamples, jobSamples + jobLength);
+        input = copies[index].data();
+    }
+    softResults[index].clear();
+    results[index] = engines[index]->demodulate(input, jobLength, jobSoft ? &softResults[index] : nullptr);
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> RaceDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    if(!racing) {
+        std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = engines[0]->demodulate(samples, length, soft);
+        if(engines[0]->getIsInSync()) {
+            lostSamples = 0;
+        } else if((lostSamples += length) > RACE_LOSS_TIME * sampleRate) {
+            startRace();
+        }
+        return res;
+    }
+    jobSamples = samples;
+    jobLength = length;
+    jobSoft = soft != nullptr;
+    pool.run(count, [this](int i) { runHypothesis(i); });
+    for(int i = 0; i < count; i++) {
+        if(!engines[i]->getIsInSync()) {
+            continue;
+        }
+        //winner goes to 0, nearest loser stays as the standby, the rest are torn down
+        std::unique_ptr<DemodEngine> winner = std::move(engines[i]);
+        standby = std::move(engines[i > 0 ? i - 1 : 1]);
+        engines.clear();
+        engines.push_back(std::move(winner));
+        racing = false;
+        lostSamples = 0;
+        wins++;
+        if(soft != nullptr) {
+            soft->insert(soft->end(), softResults[i].begin(), softResults[i].end());
+        }
+        return results[i];
+    }
+    //nobody is in sync, symbols of all hypotheses are noise
+    return std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>();
+}
+
+void RaceDemodEngine::setLowFreq(double freq) {
+    loFreq = freq;
+    for(size_t i = 0; i < engines.size(); i++) {
+        engines[i]->setLowFreq(freq);
+        if(racing && i > 0) {
+            engines[i]->setCenterFreq(loFreq + (hiFreq - loFreq) * (i - 0.5) / (count - 1));
+        }
+    }
+}
+
+void RaceDemodEngine::setHighFreq(double freq) {
+    hiFreq = freq;
+    for(size_t i = 0; i < engines.size(); i++) {
+        engines[i]->setHighFreq(freq);
+        if(racing && i > 0) {
+            engines[i]->setCenterFreq(loFreq + (hiFreq - loFreq) * (i - 0.5) / (count - 1));
+        }
+    }
+}
+
+void RaceDemodEngine::setCenterFreq(double freq) {
+    centFreq = freq;
+    engines[0]->setCenterFreq(freq);
+}
+
+double RaceDemodEngine::getCenterFreq() {
+    return engines[0]->getCenterFreq();
+}
+
+bool RaceDemodEngine::getIsInSync() {
+    return !racing && engines[0]->getIsInSync();
+}
+
+std::string RaceDemodEngine::getStats() {
+    std::ostringstream os;
+    os << engines[0]->getStats() << " race = ";
+    if(racing) {
+        os << "racing at";
+        for(int i = 0; i < count; i++) {
+            os << (i > 0 ? "/" : " ") << (int)engines[i]->getCenterFreq();
+        }
+        os << " Hz";
+    } else {
+        os << "locked";
+    }
+    os << " (" << wins << " wins of " << races << " races)";
+    return os.str();
+}
+
+SquelchDemodEngine::SquelchDemodEngine(DemodEngine* engine, double sampleRate, double freqOffset, double thresholdDb) : fft(SQUELCH_FFT_SIZE) {
+    this->engine.reset(engine);
+    this->sampleRate = sampleRate;
+    this->freqOffset = freqOffset;
+    this->thresholdDb = thresholdDb;
+    loFreq = FASTDEMOD_DEFAULT_LO_FREQ;
+    hiFreq = FASTDEMOD_DEFAULT_HI_FREQ;
+    window.resize(SQUELCH_FFT_SIZE);
+    for(int i = 0; i < SQUELCH_FFT_SIZE; i++) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / (SQUELCH_FFT_SIZE - 1));
+    }
+    spectrum.resize(SQUELCH_FFT_SIZE);
+    windowPos = 0;
+    skip = 0;
+    windows = 0;
+    level = 0;
+    open = false;
+    closingSamples = 0;
+    preroll.resize((size_t)(SQUELCH_PREROLL * sampleRate));
+    prerollPos = 0;
+    prerollFilled = 0;
+    totalSamples = 0;
+    skippedSamples = 0;
+    opens = 0;
+    updateBand();
+}
+
+//widens first..last to at least width bins, keeping it inside -limit..limit
+static void widenBins(int* first, int* last, int width, int limit) {
+    int extra = std::max(0, width - (*last - *first + 1));
+    *first -= extra / 2;
+    *last += extra - extra / 2;
+    if(*first < -limit) {
+        *last += -limit - *first;
+        *first = -limit;
+    }
+    if(*last > limit) {
+        *first -= *last - limit;
+        *last = limit;
+    }
+    *first = std::max(*first, -limit);
+}
+
+void SquelchDemodEngine::updateBand() {
+    int limit = SQUELCH_FFT_SIZE / 2 - 1;
+    carrierBins = std::min(2 * limit + 1, (int)std::ceil(FASTDEMOD_SYMBOL_RATE * (1 + FASTDEMOD_ROLLOFF) * SQUELCH_FFT_SIZE / sampleRate));
+    int bandFirst = std::max(-limit, (int)std::floor((loFreq - freqOffset) * SQUELCH_FFT_SIZE / sampleRate));
+    int bandLast = std::min(limit, (int)std::ceil((hiFreq - freqOffset) * SQUELCH_FFT_SIZE / sampleRate));
+    if(bandLast < bandFirst) {
+        bandLast = bandFirst;
+    }
+    //a band narrower than the carrier is searched over the carrier width
+    widenBins(&bandFirst, &bandLast, carrierBins, limit);
+    int first = bandFirst;
+    int last = bandLast;
+    widenBins(&first, &last, SQUELCH_NOISE_WIDTH * carrierBins, limit);
+    bins.clear();
+    for(int k = first; k <= last; k++) {
+        bins.push_back((k + SQUELCH_FFT_SIZE) % SQUELCH_FFT_SIZE);
+    }
+    bandStart = bandFirst - first;
+    bandEnd = bandLast - first;
+    power.assign(bins.size(), 0.0);
+    windows = 0;
+}
+
+bool SquelchDemodEngine::isBandValid() {
+    return (int)bins.size() >= 2 * carrierBins + 1;
+}
+
+void SquelchDemodEngine::measure(const std::complex<double>* samples, int length) {
+    int pos = 0;
+    while(pos < length) {
+        if(skip > 0) {
+            int n = (int)std::min(skip, (long long)(length - pos));
+            skip -= n;
+            pos += n;
+            continue;
+        }
+        int n = std::min(SQUELCH_FFT_SIZE - windowPos, length - pos);
+        for(int i = 0; i < n; i++) {
+            spectrum[windowPos + i] = samples[pos + i] * window[windowPos + i];
+        }
+        windowPos += n;
+        pos += n;
+        if(windowPos < SQUELCH_FFT_SIZE) {
+            break;
+        }
+        fft.transform(spectrum.data());
+        windowPos = 0;
+        skip = SQUELCH_WINDOW_INTERVAL - SQUELCH_FFT_SIZE;
+        //plain mean of the first windows, so the average starts without the bias of zero
+        windows = std::min(windows + 1, SQUELCH_WINDOWS);
+        for(size_t i = 0; i < bins.size(); i++) {
+            power[i] += (std::norm(spectrum[bins[i]]) - power[i]) / windows;
+        }
+        if(windows < SQUELCH_WINDOWS) {
+            continue;
+        }
+        //the carrier is under a half of the noise bins, so their median is noise also when lo..hi is set narrow around it
+        std::vector<double> sorted = power;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        double noise = sorted[sorted.size() / 2];
+        //the carrier can be anywhere in the band, so the strongest part of its width is taken
+        double sum = 0;
+        double best = 0;
+        for(int i = bandStart; i <= bandEnd; i++) {
+            sum += power[i];
+            if(i - bandStart >= carrierBins) {
+                sum -= power[i - carrierBins];
+            }
+            if(i - bandStart >= carrierBins - 1) {
+                best = std::max(best, sum / carrierBins);
+            }
+        }
+        level = noise > 0 ? 10 * std::log10(best / noise) : 0;
+    }
+}
+
+void SquelchDemodEngine::keepPreroll(const std::complex<double>* samples, int length) {
+    size_t capacity = preroll.size();
+    if(capacity == 0) {
+        return;
+    }
+    if((size_t)length > capacity) {
+        samples += length - capacity;
+        length = capacity;
+    }
+    size_t first = std::min((size_t)length, capacity - prerollPos);
+    std::copy(samples, samples + first, preroll.begin() + prerollPos);
+    std::copy(samples + first, samples + length, preroll.begin());
+    prerollPos = (prerollPos + length) % capacity;
+    prerollFilled = std::min(capacity, prerollFilled + length);
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> SquelchDemodEngine::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> results;
+    //the library demodulator may change the samples, so they are measured first
+    measure(samples, length);
+    totalSamples += length;
+    if(!open) {
+        if(level < thresholdDb) {
+            keepPreroll(samples, length);
+            skippedSamples += length;
+            return results;
+        }
+        open = true;
+        opens++;
+        closingSamples = 0;
+        //oldest part of the ring first
+        size_t capacity = preroll.size();
+        size_t start = (prerollPos + capacity - prerollFilled) % capacity;
+        size_t first = std::min(prerollFilled, capacity - start);
+        if(first > 0) {
+            results = engine->demodulate(preroll.data() + start, first, soft);
+        }
+        if(prerollFilled > first) {
+            std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = engine->demodulate(preroll.data(), prerollFilled - first, soft);
+            results.insert(results.end(), res.begin(), res.end());
+        }
+        prerollFilled = 0;
+    }
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = engine->demodulate(samples, length, soft);
+    results.insert(results.end(), res.begin(), res.end());
+    if(level < thresholdDb - SQUELCH_HYSTERESIS && !engine->getIsInSync()) {
+        closingSamples += length;
+        if(closingSamples >= SQUELCH_HOLD_TIME * sampleRate) {
+            open = false;
+        }
+    } else {
+        closingSamples = 0;
+    }
+    return results;
+}
+
+void SquelchDemodEngine::setLowFreq(double freq) {
+    loFreq = freq;
+    updateBand();
+    engine->setLowFreq(freq);
+}
+
+void SquelchDemodEngine::setHighFreq(double freq) {
+    hiFreq = freq;
+    updateBand();
+    engine->setHighFreq(freq);
+}
+
+void SquelchDemodEngine::setCenterFreq(double freq) {
+    engine->setCenterFreq(freq);
+}
+
+double SquelchDemodEngine::getCenterFreq() {
+    return engine->getCenterFreq();
+}
+
+bool SquelchDemodEngine::getIsInSync() {
+    return open && engine->getIsInSync();
+}
+
+std::string SquelchDemodEngine::getStats() {
+    std::ostringstream os;
+    os << engine->getStats() << " sql = " << (open ? "open" : "closed") << " " << (int)std::round(level * 10) / 10.0 << " dB (" << opens << " opens, skipped " << (totalSamples > 0 ? 100 * skippedSamples / totalSamples : 0) << "%)";
+    return os.str();
+}
+
+//the engine selected with --demod-engine, fast one can work on shifted and decimated input
+static DemodEngine* createBaseEngine(std::string engine, double sampleRate, double freqOffset) {
+    if(engine == "lib") {
+        return new LibDemodEngine();
+    } else if(engine == "fast") {
+        return new FastDemodEngine(sampleRate, freqOffset);
+    }
+    return new CompareDemodEngine();
+}
+
+DemodEngine* createDemodEngine(std::map<std::string, std::string>& params) {
+    std::string engine = "lib";
+    if(params.find("demodEngine") != params.end()) {
+        engine = params["demodEngine"];
+    }
+    double sampleRate = 48000;
+    double freqOffset = 0;
+    if(params.find("demodSourceHilbertDecim") != params.end() && std::atoi(params["demodSourceHilbertDecim"].c_str()) > 1) {
+        //decimated baseband input is supported only by the in-tree demodulator
+        if(engine != "fast") {
+            std::cout << "--hilbert-decim requires --demod-engine fast!" << std::endl;
+            return nullptr;
+        }
+        int decimation = std::atoi(params["demodSourceHilbertDecim"].c_str());
+        double centFreq = FASTDEMOD_DEFAULT_CENTER_FREQ;
+        if(params.find("demodCentFreq") != params.end()) {
+            centFreq = std::atoi(params["demodCentFreq"].c_str());
+        }
+        sampleRate = 48000.0 / decimation;
+        freqOffset = centFreq;
+    }
+    if(params.find("demodRace") != params.end()) {
+        int count = std::atoi(params["demodRace"].c_str());
+        if(count < 2 || count > RACE_MAX_HYPOTHESES) {
+            std::cout << "--race requires 2.." << RACE_MAX_HYPOTHESES << " hypotheses!" << std::endl;
+            return nullptr;
+        }
+        if(engine == "compare" || params.find("demodAutoTune") != params.end()) {
+            std::cout << "--race can't be combined with compare engine and --auto-tune!" << std::endl;
+            return nullptr;
+        }
+    }
+    if(engine != "lib" && engine != "fast" && engine != "compare") {
+        std::cout << "Wrong demodulator engine!" << std::endl;
+        return nullptr;
+    }
+    DemodEngine* demod;
+    if(params.find("demodRace") != params.end()) {
+        //the library demodulator may change the samples, so its hypotheses get own copies
+        demod = new RaceDemodEngine([engine, sampleRate, freqOffset]() { return createBaseEngine(engine, sampleRate, freqOffset); }, std::atoi(params["demodRace"].c_str()), engine == "lib", sampleRate);
+    } else {
+        demod = createBaseEngine(engine, sampleRate, freqOffset);
+    }
+    if(params.find("demodAutoTune") != params.end()) {
+        double thresholdDb = std::atof(params["demodAutoTune"].c_str());
+        demod = new AutoTuneDemodEngine(demod, sampleRate, freqOffset, thresholdDb, engine == "fast" ? 0 : AUTOTUNE_LIB_BIAS);
+    }
+    SquelchDemodEngine* squelch = nullptr;
+    if(params.find("demodSquelch") != params.end()) {
+        squelch = new SquelchDemodEngine(demod, sampleRate, freqOffset, std::atof(params["demodSquelch"].c_str()));
+        demod = squelch;
+    }
+    if(params.find("demodLoFreq") != params.end()) {
+        int loFreq = std::atoi(params["demodLoFreq"].c_str());
+        demod->setLowFreq(loFreq);
+    }
+    if(params.find("demodHiFreq") != params.end()) {
+        int hiFreq = std::atoi(params["demodHiFreq"].c_str());
+        demod->setHighFreq(hiFreq);
+    }
+    if(params.find("demodCentFreq") != params.end()) {
+        int centFreq = std::atoi(params["demodCentFreq"].c_str());
+        demod->setCenterFreq(centFreq);
+    }
+    if(squelch != nullptr && !squelch->isBandValid()) {
+        std::cout << "Sample rate is too low for --squelch!" << std::endl;
+        delete demod;
+        return nullptr;
+    }
+    return demod;
+}
@@ -0,0 +1,245 @@
+#ifndef DEMOD_ENGINE_H
+#define DEMOD_ENGINE_H
+
+#include <complex>
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <inmarsatc_demodulator.h>
+#include "fast_demodulator.h"
+#include "acquisition.h"
+#include "worker_pool.h"
+
+//windows averaged for one carrier estimate(~0.7 s at 48k)
+#define AUTOTUNE_WINDOWS 8
+//estimate is dropped if the demodulator doesn't get in sync in this time
+#define AUTOTUNE_SYNC_TIMEOUT 5
+//acquisition is restarted after sync is lost for this time
+#define AUTOTUNE_LOSS_TIME 2
+//estimates closer than this to the demodulator frequency are left to its own loop
+#define AUTOTUNE_MIN_CORRECTION 30
+//library demodulator locks better when tuned a bit above the carrier
+#define AUTOTUNE_LIB_BIAS 100
+
+//hypotheses are raced again after the winner is out of sync for this time
+#define RACE_LOSS_TIME 2
+#define RACE_MAX_HYPOTHESES 16
+
+//in-band spectrum is measured on one fft window of every interval samples, and kept as a running average with
+//the time constant of windows(~680 ms at 48k)
+#define SQUELCH_FFT_SIZE 256
+#define SQUELCH_WINDOW_INTERVAL 4096
+#define SQUELCH_WINDOWS 8
+//strongest carrier wide part of the lo..hi band over the median of the noise bins in dB
+#define SQUELCH_DEFAULT_THRESHOLD 3
+//noise bins are the band widened to at least this many carrier widths, so the carrier is under a half of them
+#define SQUELCH_NOISE_WIDTH 3
+//squelch closes this much below the threshold, after the demodulator is out of sync for the hold time
+#define SQUELCH_HYSTERESIS 1.5
+#define SQUELCH_HOLD_TIME 2
+//input before the squelch opens given to the demodulator, seconds
+#define SQUELCH_PREROLL 1
+
+//symbols compared at once by the differential mode, and maximum delay between engines
+#define COMPARE_WINDOW 1024
+#define COMPARE_MAX_LAG 512
+
+//common interface of demodulator implementations selected with --demod-engine
+class DemodEngine {
+public:
+    virtual ~DemodEngine() {}
+    //soft gets one chunk of soft decisions for every returned chunk, if not nullptr; engines without soft output give full confidence to the hard symbols
+    virtual std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr) = 0;
+    virtual void setLowFreq(double freq) = 0;
+    virtual void setHighFreq(double freq) = 0;
+    virtual void setCenterFreq(double freq) = 0;
+    virtual double getCenterFreq() = 0;
+    virtual bool getIsInSync() = 0;
+    //additional statistics for --stats line
+    virtual std::string getStats() {
+        return "";
+    }
+};
+
+//inmarsatc library demodulator
+class LibDemodEngine : public DemodEngine {
+public:
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+private:
+    inmarsatc::demodulator::Demodulator demod;
+};
+
+//in-tree single precision demodulator
+//input can be shifted down by freqOffset(--hilbert-decim), frequencies are translated back for the user
+class FastDemodEngine : public DemodEngine {
+public:
+    FastDemodEngine(double sampleRate = 48000, double freqOffset = 0);
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+private:
+    FastDemodulator demod;
+    double freqOffset;
+};
+
+//runs both engines on the same input, outputs symbols of the library one and compares symbol streams
+class CompareDemodEngine : public DemodEngine {
+public:
+    CompareDemodEngine();
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+    std::string getStats();
+private:
+    void compare();
+    LibDemodEngine lib;
+    FastDemodEngine fast;
+    std::vector<uint8_t> libSymbols;
+    std::vector<uint8_t> fastSymbols;
+    long long comparedSymbols;
+    long long matchedSymbols;
+    double lastAgreement;
+    int lastLag;
+};
+
+//estimates the carrier frequency with CarrierDetector at start and after sync loss, and tunes the wrapped engine to it
+//freqOffset is the shift of the input relative to the user frequencies(--hilbert-decim)
+class AutoTuneDemodEngine : public DemodEngine {
+public:
+    AutoTuneDemodEngine(DemodEngine* engine, double sampleRate, double freqOffset, double thresholdDb, double bias);
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+    std::string getStats();
+private:
+    enum State {
+        ACQUIRING,
+        WAITING_SYNC,
+        TRACKING
+    };
+    void startAcquisition();
+    std::unique_ptr<DemodEngine> engine;
+    std::unique_ptr<CarrierDetector> detector;
+    double sampleRate;
+    double freqOffset;
+    double thresholdDb;
+    double bias;
+    double loFreq;
+    double hiFreq;
+    State state;
+    std::vector<std::complex<double>> window;
+    int windowPos;
+    long long stateSamples;
+    int acquisitions;
+    double lastEstimate;
+    double lastRatio;
+};
+
+//runs count hypotheses of the engine at different center frequencies across lo..hi on parallel threads
+//symbols are forwarded only from the hypothesis which got in sync first, after that only it is running and one more is kept as the standby
+//factory creates the hypotheses, copyInput is needed for engines which may change the samples(library one), others share the input
+class RaceDemodEngine : public DemodEngine {
+public:
+    RaceDemodEngine(std::function<DemodEngine*()> factory, int count, bool copyInput, double sampleRate);
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+    std::string getStats();
+private:
+    void startRace();
+    void runHypothesis(int index);
+    std::function<DemodEngine*()> factory;
+    int count;
+    bool copyInput;
+    double sampleRate;
+    double loFreq;
+    double hiFreq;
+    double centFreq;
+    //all hypotheses while racing, only the winner after that
+    std::vector<std::unique_ptr<DemodEngine>> engines;
+    std::unique_ptr<DemodEngine> standby;
+    std::vector<std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>> results;
+    std::vector<std::vector<SoftChunk>> softResults;
+    std::vector<std::vector<std::complex<double>>> copies;
+    bool racing;
+    long long lostSamples;
+    int races;
+    int wins;
+    WorkerPool pool;
+    std::complex<double>* jobSamples;
+    int jobLength;
+    bool jobSoft;
+};
+
+//passes the input to the wrapped engine only while the level of lo..hi band is over the threshold, so idle channels cost almost nothing
+//last SQUELCH_PREROLL seconds are kept while closed and given to the engine first, so it can lock on the beginning of the signal
+class SquelchDemodEngine : public DemodEngine {
+public:
+    SquelchDemodEngine(DemodEngine* engine, double sampleRate, double freqOffset, double thresholdDb);
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+    std::string getStats();
+    //false if there are too few bins for the noise estimate at the sample rate
+    bool isBandValid();
+private:
+    void updateBand();
+    void measure(const std::complex<double>* samples, int length);
+    void keepPreroll(const std::complex<double>* samples, int length);
+    std::unique_ptr<DemodEngine> engine;
+    Fft fft;
+    double sampleRate;
+    double freqOffset;
+    double thresholdDb;
+    double loFreq;
+    double hiFreq;
+    std::vector<double> window;
+    std::vector<std::complex<double>> spectrum;
+    //fft bins of the noise estimate in the order of frequency, the carrier is searched in bandStart..bandEnd of them
+    std::vector<int> bins;
+    int bandStart;
+    int bandEnd;
+    //running average of the bins
+    std::vector<double> power;
+    int carrierBins;
+    int windowPos;
+    long long skip;
+    int windows;
+    //in-band level of the last estimate, dB
+    double level;
+    bool open;
+    long long closingSamples;
+    std::vector<std::complex<double>> preroll;
+    size_t prerollPos;
+    size_t prerollFilled;
+    long long totalSamples;
+    long long skippedSamples;
+    int opens;
+};
+
+//creates the engine selected with --demod-engine and applies --lo-freq, --hi-freq, --cent-freq, --auto-tune --race and --squelch; returns nullptr for unknown engine
+DemodEngine* createDemodEngine(std::map<std::string, std::string>& params);
+
+#endif // DEMOD_ENGINE_H
@@ -0,0 +1,256 @@
+#include "dsp.h"
+#include <cmath>
+#include <algorithm>
+
+static double blackman(int i, int count) {
+    if(count <= 1) {
+        return 1.0;
+    }
+    double x = 2.0 * M_PI * i / (count - 1);
+    return 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x);
+}
+
+std::vector<double> designLowpass(int tapsCount, double cutoff) {
+    std::vector<double> taps(tapsCount);
+    double center = (tapsCount - 1) / 2.0;
+    double sum = 0;
+    for(int i = 0; i < tapsCount; i++) {
+        double t = i - center;
+        double sinc = std::fabs(t) < 1e-9 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        taps[i] = sinc * blackman(i, tapsCount);
+        sum += taps[i];
+    }
+    for(int i = 0; i < tapsCount; i++) {
+        taps[i] /= sum;
+    }
+    return taps;
+}
+
+std::vector<double> designHilbert(int tapsCount) {
+    std::vector<double> taps(tapsCount, 0.0);
+    int center = (tapsCount - 1) / 2;
+    for(int i = 0; i < tapsCount; i++) {
+        int k = i - center;
+        if(k % 2 != 0) {
+            taps[i] = 2.0 / (M_PI * k) * blackman(i, tapsCount);
+        }
+    }
+    return taps;
+}
+
+void mixDown(std::complex<double>* buf, int count, double* phase, double step) {
+    std::complex<double> p = std::polar(1.0, -*phase);
+    std::complex<double> s = std::polar(1.0, -step);
+    for(int i = 0; i < count; i++) {
+        buf[i] *= p;
+        p *= s;
+    }
+    *phase = std::fmod(*phase + step * count, 2 * M_PI);
+}
+
+DecimatingFir::DecimatingFir(std::vector<double> taps, int decimation) {
+    this->taps = taps;
+    this->decimation = decimation;
+    phase = 0;
+    history.assign(taps.size() - 1, std::complex<double>(0, 0));
+}
+
+int DecimatingFir::process(const std::complex<double>* in, int count, std::complex<double>* out) {
+    int tapsCount = taps.size();
+    int historyLen = tapsCount - 1;
+    history.resize(historyLen + count);
+    for(int i = 0; i < count; i++) {
+        history[historyLen + i] = in[i];
+    }
+    int outputs = 0;
+    int i = (decimation - phase) % decimation;
+    for(; i < count; i += decimation) {
+        //window ends at the current input sample
+        const std::complex<double>* x = history.data() + i;
+        double re = 0;
+        double im = 0;
+        for(int k = 0; k < tapsCount; k++) {
+            re += x[k].real() * taps[tapsCount - 1 - k];
+            im += x[k].imag() * taps[tapsCount - 1 - k];
+        }
+        out[outputs++] = std::complex<double>(re, im);
+    }
+    phase = (phase + count) % decimation;
+    for(int k = 0; k < historyLen; k++) {
+        history[k] = history[count + k];
+    }
+    history.resize(historyLen);
+    return outputs;
+}
+
+HalfbandDecimator::HalfbandDecimator(int tapsCount) {
+    std::vector<double> taps = designLowpass(tapsCount, 0.25);
+    center = (tapsCount - 1) / 2;
+    centerTap = taps[center];
+    for(int k = 1; k <= center; k += 2) {
+        oddTaps.push_back(taps[center + k]);
+    }
+    phase = 0;
+    history.assign(2 * center, std::complex<double>(0, 0));
+}
+
+int HalfbandDecimator::process(const std::complex<double>* in, int count, std::complex<double>* out) {
+    int historyLen = 2 * center;
+    history.resize(historyLen + count);
+    for(int i = 0; i < count; i++) {
+        history[historyLen + i] = in[i];
+    }
+    int outputs = 0;
+    int oddCount = oddTaps.size();
+    for(int i = phase; i < count; i += 2) {
+        //window ends at the current input sample, taps are symmetric around the middle of it
+        const std::complex<double>* mid = history.data() + i + center;
+        std::complex<double> acc = centerTap * mid[0];
+        for(int t = 0; t < oddCount; t++) {
+            int k = 2 * t + 1;
+            acc += oddTaps[t] * (mid[-k] + mid[k]);
+        }
+        out[outputs++] = acc;
+    }
+    phase = (phase + count) % 2;
+    for(int k = 0; k < historyLen; k++) {
+        history[k] = history[count + k];
+    }
+    history.resize(historyLen);
+    return outputs;
+}
+
+PolyphaseResampler::PolyphaseResampler(int interpolation, int decimation, int tapsPerPhase) {
+    this->interpolation = interpolation;
+    this->decimation = decimation;
+    this->tapsPerPhase = tapsPerPhase;
+    //prototype runs at interpolation*inRate, gain compensates zeros inserted between the samples
+    std::vector<double> taps = designLowpass(interpolation * tapsPerPhase, RESAMPLER_PASSBAND * 0.5 / std::max(interpolation, decimation));
+    bank.resize(interpolation * tapsPerPhase);
+    for(int p = 0; p < interpolation; p++) {
+        for(int k = 0; k < tapsPerPhase; k++) {
+            bank[p * tapsPerPhase + tapsPerPhase - 1 - k] = taps[k * interpolation + p] * interpolation;
+        }
+    }
+    history.assign(tapsPerPhase - 1, std::complex<double>(0, 0));
+    phase = 0;
+    nextIndex = 0;
+}
+
+int PolyphaseResampler::process(const std::complex<double>* in, int count, std::complex<double>* out) {
+    int historyLen = tapsPerPhase - 1;
+    history.resize(historyLen + count);
+    for(int i = 0; i < count; i++) {
+        history[historyLen + i] = in[i];
+    }
+    int outputs = 0;
+    while(nextIndex < count) {
+        const std::complex<double>* x = history.data() + nextIndex;
+        const double* h = bank.data() + phase * tapsPerPhase;
+        double re = 0;
+        double im = 0;
+        for(int j = 0; j < tapsPerPhase; j++) {
+            re += x[j].real() * h[j];
+            im += x[j].imag() * h[j];
+        }
+        out[outputs++] = std::complex<double>(re, im);
+        phase += decimation;
+        nextIndex += phase / interpolation;
+        phase %= interpolation;
+    }
+    nextIndex -= count;
+    for(int k = 0; k < historyLen; k++) {
+        history[k] = history[count + k];
+    }
+    history.resize(historyLen);
+    return outputs;
+}
+
+static long long gcd(long long a, long long b) {
+    while(b != 0) {
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+//closest fraction num/den of value with den <= maxDen(continued fractions)
+static void approximateRatio(double value, int maxDen, int* num, int* den) {
+    long long p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    double x = value;
+    for(int i = 0; i < 64; i++) {
+        long long a = (long long)std::floor(x);
+        long long p2 = a * p1 + p0;
+        long long q2 = a * q1 + q0;
+        if(q2 > maxDen) {
+            break;
+        }
+        p0 = p1; q0 = q1; p1 = p2; q1 = q2;
+        double frac = x - a;
+        if(frac < 1e-9) {
+            break;
+        }
+        x = 1.0 / frac;
+    }
+    *num = (int)p1;
+    *den = (int)q1;
+}
+
+Resampler::Resampler(double inRate, double outRate) {
+    this->inRate = inRate;
+    long long in = (long long)std::llround(inRate);
+    long long out = (long long)std::llround(outRate);
+    long long g = gcd(in, out);
+    if(in == inRate && out == outRate && out / g <= RESAMPLER_MAX_PHASES) {
+        interpolation = out / g;
+        decimation = in / g;
+    } else {
+        approximateRatio(inRate / outRate, RESAMPLER_MAX_PHASES, &decimation, &interpolation);
+    }
+    //cheap halfband stages first, as long as the rest is still decimation
+    while(decimation % 2 == 0 && decimation / 2 >= interpolation) {
+        halfbands.emplace_back(new HalfbandDecimator(HALFBAND_TAPS));
+        decimation /= 2;
+    }
+    if(interpolation == 1 && decimation > 1) {
+        decimator.reset(new DecimatingFir(designLowpass(RESAMPLER_TAPS_PER_PHASE * decimation + 1, RESAMPLER_PASSBAND * 0.5 / decimation), decimation));
+    } else if(interpolation > 1 || decimation > 1) {
+        int tapsPerPhase = RESAMPLER_TAPS_PER_PHASE * ((decimation + interpolation - 1) / interpolation);
+        polyphase.reset(new PolyphaseResampler(interpolation, decimation, tapsPerPhase));
+    }
+}
+
+int Resampler::process(std::complex<double>* in, int count, std::complex<double>* out) {
+    for(size_t i = 0; i < halfbands.size(); i++) {
+        count = halfbands[i]->process(in, count, in);
+    }
+    if(decimator) {
+        return decimator->process(in, count, out);
+    }
+    if(polyphase) {
+        return polyphase->process(in, count, out);
+    }
+    std::copy(in, in + count, out);
+    return count;
+}
+
+int Resampler::getMaxOutput(int count) {
+    return (int)((long long)count * interpolation / decimation) + 2;
+}
+
+double Resampler::getOutRate() {
+    return inRate / (1 << halfbands.size()) * interpolation / decimation;
+}
+
+int Resampler::getHalfbandCount() {
+    return halfbands.size();
+}
+
+int Resampler::getInterpolation() {
+    return interpolation;
+}
+
+int Resampler::getDecimation() {
+    return decimation;
+}
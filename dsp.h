@@ -0,0 +1,90 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#define HALFBAND_TAPS 31
+#define RESAMPLER_TAPS_PER_PHASE 32
+#define RESAMPLER_MAX_PHASES 512
+//part of the output band kept by resampler filters
+#define RESAMPLER_PASSBAND 0.8
+
+//blackman windowed sinc lowpass, cutoff is normalized to the sample rate(0..0.5), unity gain at dc
+std::vector<double> designLowpass(int tapsCount, double cutoff);
+//blackman windowed hilbert transformer(odd length, zero even taps)
+std::vector<double> designHilbert(int tapsCount);
+
+//buf[n] *= exp(-j*(phase + step*n)); phase is advanced and wrapped
+void mixDown(std::complex<double>* buf, int count, double* phase, double step);
+
+//fir filter with real taps computing only every decimation-th output
+class DecimatingFir {
+public:
+    DecimatingFir(std::vector<double> taps, int decimation);
+    //filters count samples; outputs are written to out, which can be the same buffer as in; returns count of outputs
+    int process(const std::complex<double>* in, int count, std::complex<double>* out);
+private:
+    std::vector<double> taps;
+    std::vector<std::complex<double>> history;
+    int decimation;
+    int phase;
+};
+
+//halfband lowpass decimating by 2, only the center and odd taps are nonzero
+class HalfbandDecimator {
+public:
+    HalfbandDecimator(int tapsCount);
+    //same as DecimatingFir::process(), out can be the same buffer as in
+    int process(const std::complex<double>* in, int count, std::complex<double>* out);
+private:
+    double centerTap;
+    //taps at offsets 1, 3, 5... from the center
+    std::vector<double> oddTaps;
+    int center;
+    std::vector<std::complex<double>> history;
+    int phase;
+};
+
+//rational interpolation/decimation, taps of the prototype lowpass are split to interpolation phases in advance
+class PolyphaseResampler {
+public:
+    PolyphaseResampler(int interpolation, int decimation, int tapsPerPhase);
+    //out must not overlap in and have space for count*interpolation/decimation+1 samples
+    int process(const std::complex<double>* in, int count, std::complex<double>* out);
+private:
+    int interpolation;
+    int decimation;
+    int tapsPerPhase;
+    //bank[phase*tapsPerPhase+j], reversed so the last tap meets the newest sample
+    std::vector<double> bank;
+    std::vector<std::complex<double>> history;
+    int phase;
+    int nextIndex;
+};
+
+//converts inRate to outRate: halfband stages while the ratio is divisible by 2, then decimating fir for the integer ratio or polyphase resampler
+//rates without small common divisor are approximated with interpolation up to RESAMPLER_MAX_PHASES, the timing loop of the demodulator absorbs the difference
+class Resampler {
+public:
+    Resampler(double inRate, double outRate);
+    //in is used as a scratch buffer; returns count of samples written to out
+    int process(std::complex<double>* in, int count, std::complex<double>* out);
+    //maximum count of outputs for count inputs
+    int getMaxOutput(int count);
+    //actual output rate after ratio approximation
+    double getOutRate();
+    int getHalfbandCount();
+    int getInterpolation();
+    int getDecimation();
+private:
+    double inRate;
+    int interpolation;
+    int decimation;
+    std::vector<std::unique_ptr<HalfbandDecimator>> halfbands;
+    std::unique_ptr<DecimatingFir> decimator;
+    std::unique_ptr<PolyphaseResampler> polyphase;
+};
+
+#endif // DSP_H
@@ -0,0 +1,373 @@
+#include "fast_demodulator.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FASTDEMOD_X86
+#endif
+
+//input is processed in blocks, loop frequency is moved to the nco between them
+#define FASTDEMOD_BLOCK 1024
+
+//carrier loop: normalized bandwidth 0.01 of symbol rate, damping 0.707
+#define FASTDEMOD_LOOP_BW 0.01
+#define FASTDEMOD_LOOP_DAMPING 0.707
+#define FASTDEMOD_FLL_GAIN 0.01
+#define FASTDEMOD_TIMING_ALPHA 0.01
+#define FASTDEMOD_TIMING_BETA 0.0001
+#define FASTDEMOD_AGC_RATE 0.01
+#define FASTDEMOD_LOCK_RATE 0.005
+#define FASTDEMOD_LOCK_ON 0.35
+#define FASTDEMOD_LOCK_OFF 0.2
+
+typedef void (*mixKernel)(const std::complex<double>* in, float* out, int count, double phase, double step);
+typedef std::complex<float> (*dotKernel)(const float* x, const float* taps, int count);
+
+//out = in * exp(-j*(phase + step*n)), converted to interleaved float
+static void mixScalar(const std::complex<double>* in, float* out, int count, double phase, double step) {
+    std::complex<double> p = std::polar(1.0, -phase);
+    std::complex<double> s = std::polar(1.0, -step);
+    for(int i = 0; i < count; i++) {
+        std::complex<double> v = in[i] * p;
+        out[i * 2] = (float)v.real();
+        out[i * 2 + 1] = (float)v.imag();
+        p *= s;
+    }
+}
+
+//sum of x * taps over count floats; even floats are real parts, odd are imaginary
+static std::complex<float> dotScalar(const float* x, const float* taps, int count) {
+    float re = 0;
+    float im = 0;
+    for(int i = 0; i < count; i += 2) {
+        re += x[i] * taps[i];
+        im += x[i + 1] * taps[i + 1];
+    }
+    return std::complex<float>(re, im);
+}
+
+#ifdef FASTDEMOD_X86
+
+__attribute__((target("sse3")))
+static inline __m128 cmulSse3(__m128 a, __m128 b) {
+    __m128 re = _mm_moveldup_ps(b);
+    __m128 im = _mm_movehdup_ps(b);
+    __m128 swapped = _mm_shuffle_ps(a, a, 0xB1);
+    return _mm_addsub_ps(_mm_mul_ps(a, re), _mm_mul_ps(swapped, im));
+}
+
+__attribute__((target("sse3")))
+static void mixSse3(const std::complex<double>* in, float* out, int count, double phase, double step) {
+    std::complex<double> p0 = std::polar(1.0, -phase);
+    std::complex<double> p1 = std::polar(1.0, -(phase + step));
+    std::complex<double> s = std::polar(1.0, -2 * step);
+    __m128 p = _mm_setr_ps(p0.real(), p0.imag(), p1.real(), p1.imag());
+    __m128 st = _mm_setr_ps(s.real(), s.imag(), s.real(), s.imag());
+    const double* src = (const double*)in;
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128 x = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src + i * 2)), _mm_cvtpd_ps(_mm_loadu_pd(src + i * 2 + 2)));
+        _mm_storeu_ps(out + i * 2, cmulSse3(x, p));
+        p = cmulSse3(p, st);
+    }
+    mixScalar(in + i, out + i * 2, count - i, phase + step * i, step);
+}
+
+__attribute__((target("sse3")))
+static std::complex<float> dotSse3(const float* x, const float* taps, int count) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for(int i = 0; i < count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_load_ps(taps + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_load_ps(taps + i + 4)));
+    }
+    __m128 s = _mm_add_ps(acc0, acc1);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    float r[4];
+    _mm_storeu_ps(r, s);
+    return std::complex<float>(r[0], r[1]);
+}
+
+__attribute__((target("avx")))
+static inline __m256 cmulAvx(__m256 a, __m256 b) {
+    __m256 re = _mm256_moveldup_ps(b);
+    __m256 im = _mm256_movehdup_ps(b);
+    __m256 swapped = _mm256_permute_ps(a, 0xB1);
+    return _mm256_addsub_ps(_mm256_mul_ps(a, re), _mm256_mul_ps(swapped, im));
+}
+
+__attribute__((target("avx")))
+static void mixAvx(const std::complex<double>* in, float* out, int count, double phase, double step) {
+    float lanes[8];
+    for(int k = 0; k < 4; k++) {
+        std::complex<double> pk = std::polar(1.0, -(phase + step * k));
+        lanes[k * 2] = pk.real();
+        lanes[k * 2 + 1] = pk.imag();
+    }
+    std::complex<double> s = std::polar(1.0, -4 * step);
+    __m256 p = _mm256_loadu_ps(lanes);
+    __m256 st = _mm256_setr_ps(s.real(), s.imag(), s.real(), s.imag(), s.real(), s.imag(), s.real(), s.imag());
+    const double* src = (const double*)in;
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 2));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 2 + 4));
+        __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+        _mm256_storeu_ps(out + i * 2, cmulAvx(x, p));
+        p = cmulAvx(p, st);
+    }
+    mixScalar(in + i, out + i * 2, count - i, phase + step * i, step);
+}
+
+__attribute__((target("avx")))
+static std::complex<float> dotAvx(const float* x, const float* taps, int count) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_load_ps(taps + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_load_ps(taps + i + 8)));
+    }
+    if(i < count) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_load_ps(taps + i)));
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    float r[4];
+    _mm_storeu_ps(r, s);
+    return std::complex<float>(r[0], r[1]);
+}
+
+#endif
+
+struct fastDemodKernels {
+    const char* name;
+    mixKernel mix;
+    dotKernel dot;
+};
+
+static fastDemodKernels selectKernels() {
+#ifdef FASTDEMOD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx")) {
+        fastDemodKernels k = {"avx", mixAvx, dotAvx};
+        return k;
+    }
+    if(__builtin_cpu_supports("sse3")) {
+        fastDemodKernels k = {"sse3", mixSse3, dotSse3};
+        return k;
+    }
+#endif
+    fastDemodKernels k = {"scalar", mixScalar, dotScalar};
+    return k;
+}
+
+static const fastDemodKernels& getKernels() {
+    static const fastDemodKernels kernels = selectKernels();
+    return kernels;
+}
+
+const char* FastDemodulator::getKernelName() {
+    return getKernels().name;
+}
+
+//root raised cosine impulse response, t in symbols
+static double rrc(double t, double rolloff) {
+    if(std::fabs(t) < 1e-9) {
+        return 1.0 - rolloff + 4.0 * rolloff / M_PI;
+    }
+    if(std::fabs(std::fabs(t) - 1.0 / (4.0 * rolloff)) < 1e-9) {
+        return rolloff / std::sqrt(2.0) * ((1.0 + 2.0 / M_PI) * std::sin(M_PI / (4.0 * rolloff)) + (1.0 - 2.0 / M_PI) * std::cos(M_PI / (4.0 * rolloff)));
+    }
+    return (std::sin(M_PI * t * (1.0 - rolloff)) + 4.0 * rolloff * t * std::cos(M_PI * t * (1.0 + rolloff))) / (M_PI * t * (1.0 - (4.0 * rolloff * t) * (4.0 * rolloff * t)));
+}
+
+FastDemodulator::FastDemodulator(double sampleRate) {
+    this->sampleRate = sampleRate;
+    loFreq = FASTDEMOD_DEFAULT_LO_FREQ;
+    hiFreq = FASTDEMOD_DEFAULT_HI_FREQ;
+    ncoFreq = FASTDEMOD_DEFAULT_CENTER_FREQ;
+    ncoPhase = 0;
+    loopFreq = 0;
+    decimation = std::max(1, (int)std::lround(sampleRate / (FASTDEMOD_SPS * FASTDEMOD_SYMBOL_RATE)));
+    sps = sampleRate / decimation / FASTDEMOD_SYMBOL_RATE;
+    double inputSps = sampleRate / FASTDEMOD_SYMBOL_RATE;
+    tapsCount = 2 * (int)std::lround(FASTDEMOD_FILTER_SPAN * inputSps / 2) + 1;
+    tapsFloats = (tapsCount * 2 + 7) / 8 * 8;
+    taps.resize(tapsFloats);
+    double sum = 0;
+    std::vector<double> h(tapsCount);
+    for(int i = 0; i < tapsCount; i++) {
+        h[i] = rrc((i - (tapsCount - 1) / 2) / inputSps, FASTDEMOD_ROLLOFF);
+        sum += h[i];
+    }
+    memset(taps.data(), 0, tapsFloats * sizeof(float));
+    for(int i = 0; i < tapsCount; i++) {
+        taps[i * 2] = h[i] / sum;
+        taps[i * 2 + 1] = h[i] / sum;
+    }
+    workLen = (tapsCount - 1 + FASTDEMOD_BLOCK) * 2 + tapsFloats;
+    work.resize(workLen);
+    memset(work.data(), 0, workLen * sizeof(float));
+    decimPhase = 0;
+    for(int i = 0; i < 16; i++) {
+        filtered[i] = 0;
+    }
+    filteredCount = 0;
+    timingNext = 4;
+    timingIntegrator = 0;
+    prevStrobe = 0;
+    prevSquared = 0;
+    phase = 0;
+    agc = 0;
+    lockMetric = 0;
+    isInSync = false;
+    double theta = FASTDEMOD_LOOP_BW / (FASTDEMOD_LOOP_DAMPING + 1.0 / (4.0 * FASTDEMOD_LOOP_DAMPING));
+    double d = 1.0 + 2.0 * FASTDEMOD_LOOP_DAMPING * theta + theta * theta;
+    alpha = 4.0 * FASTDEMOD_LOOP_DAMPING * theta / d;
+    beta = 4.0 * theta * theta / d;
+    chunkPos = 0;
+    chunkMagnitude = 0;
+    softResults = nullptr;
+}
+
+void FastDemodulator::setLowFreq(double freq) {
+    loFreq = freq;
+}
+
+void FastDemodulator::setHighFreq(double freq) {
+    hiFreq = freq;
+}
+
+void FastDemodulator::setCenterFreq(double freq) {
+    ncoFreq = freq;
+    loopFreq = 0;
+}
+
+double FastDemodulator::getCenterFreq() {
+    return ncoFreq + loopFreq * FASTDEMOD_SYMBOL_RATE / (2 * M_PI);
+}
+
+bool FastDemodulator::getIsInSync() {
+    return isInSync;
+}
+
+std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> FastDemodulator::demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft) {
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> results;
+    softResults = soft;
+    const fastDemodKernels& kernels = getKernels();
+    int history = tapsCount - 1;
+    for(int offset = 0; offset < length; offset += FASTDEMOD_BLOCK) {
+        int count = std::min(FASTDEMOD_BLOCK, length - offset);
+        //move the frequency found by the carrier loop to the nco
+        ncoFreq += loopFreq * FASTDEMOD_SYMBOL_RATE / (2 * M_PI);
+        loopFreq = 0;
+        if(ncoFreq < loFreq) {
+            ncoFreq = loFreq;
+        } else if(ncoFreq > hiFreq) {
+            ncoFreq = hiFreq;
+        }
+        double step = 2 * M_PI * ncoFreq / sampleRate;
+        kernels.mix(samples + offset, work.data() + history * 2, count, ncoPhase, step);
+        ncoPhase = std::fmod(ncoPhase + step * count, 2 * M_PI);
+        //matched filter, computed only for the decimated outputs
+        int i = (decimation - decimPhase) % decimation;
+        for(; i < count; i += decimation) {
+            processFilterOutput(kernels.dot(work.data() + i * 2, taps.data(), tapsFloats), &results);
+        }
+        decimPhase = (decimPhase + count) % decimation;
+        memmove(work.data(), work.data() + count * 2, history * 2 * sizeof(float));
+    }
+    return results;
+}
+
+std::complex<float> FastDemodulator::interpolate(double t) {
+    long long i = (long long)std::floor(t);
+    float mu = t - i;
+    //4 point lagrange interpolation between samples i and i+1
+    float cm1 = -mu * (mu - 1) * (mu - 2) / 6;
+    float c0 = (mu + 1) * (mu - 1) * (mu - 2) / 2;
+    float c1 = -(mu + 1) * mu * (mu - 2) / 2;
+    float c2 = (mu + 1) * mu * (mu - 1) / 6;
+    return filtered[(i - 1) & 15] * cm1 + filtered[i & 15] * c0 + filtered[(i + 1) & 15] * c1 + filtered[(i + 2) & 15] * c2;
+}
+
+void FastDemodulator::processFilterOutput(std::complex<float> y, std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>* results) {
+    filtered[filteredCount & 15] = y;
+    filteredCount++;
+    while(timingNext + 2 <= filteredCount - 1) {
+        std::complex<float> strobe = interpolate(timingNext);
+        std::complex<float> mid = interpolate(timingNext - sps / 2);
+        //gardner timing error, insensitive to the carrier phase
+        double magnitude2 = agc > 0 ? agc * agc : 1;
+        double timingError = std::real((strobe - prevStrobe) * std::conj(mid)) / magnitude2;
+        if(timingError > 1) {
+            timingError = 1;
+        } else if(timingError < -1) {
+            timingError = -1;
+        }
+        prevStrobe = strobe;
+        timingIntegrator -= FASTDEMOD_TIMING_BETA * timingError;
+        if(timingIntegrator > sps / 4) {
+            timingIntegrator = sps / 4;
+        } else if(timingIntegrator < -sps / 4) {
+            timingIntegrator = -sps / 4;
+        }
+        timingNext += sps - FASTDEMOD_TIMING_ALPHA * timingError * sps + timingIntegrator;
+        processSymbol(strobe, results);
+    }
+}
+
+void FastDemodulator::processSymbol(std::complex<float> strobe, std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>* results) {
+    double magnitude = std::abs(strobe);
+    if(agc <= 0) {
+        agc = magnitude;
+    } else {
+        agc += FASTDEMOD_AGC_RATE * (magnitude - agc);
+    }
+    std::complex<double> z = std::complex<double>(strobe.real(), strobe.imag()) * std::polar(1.0, -phase);
+    if(agc > 0) {
+        z /= agc;
+    }
+    //costas loop
+    double phaseError = z.real() * z.imag();
+    if(phaseError > 1) {
+        phaseError = 1;
+    } else if(phaseError < -1) {
+        phaseError = -1;
+    }
+    //squaring frequency discriminator helps to pull in before the lock
+    std::complex<float> squared = std::complex<float>(z * z);
+    if(!isInSync) {
+        loopFreq += FASTDEMOD_FLL_GAIN * std::arg(squared * std::conj(prevSquared)) / 2;
+    }
+    prevSquared = squared;
+    loopFreq += beta * phaseError;
+    phase = std::fmod(phase + loopFreq + alpha * phaseError, 2 * M_PI);
+    double power = std::norm(z);
+    if(power > 0) {
+        lockMetric += FASTDEMOD_LOCK_RATE * ((z.real() * z.real() - z.imag() * z.imag()) / power - lockMetric);
+    }
+    if(!isInSync && lockMetric > FASTDEMOD_LOCK_ON) {
+        isInSync = true;
+    } else if(isInSync && lockMetric < FASTDEMOD_LOCK_OFF) {
+        isInSync = false;
+    }
+    chunk.bitsDemodulated[chunkPos] = z.real() > 0 ? 1 : 0;
+    //real part is normalized by the agc, so +-1 is the nominal symbol; never 0, so the sign is the hard symbol
+    int softValue = (int)std::max(1.0, std::min((double)SOFT_SYMBOL_MAX, std::round(std::fabs(z.real()) * SOFT_SYMBOL_MAX)));
+    softChunk.symbols[chunkPos] = (int8_t)(z.real() > 0 ? softValue : -softValue);
+    chunkMagnitude += magnitude;
+    chunkPos++;
+    if(chunkPos == DEMODULATOR_SYMBOLSPERCHUNK) {
+        chunk.meanMagnitude = chunkMagnitude / DEMODULATOR_SYMBOLSPERCHUNK;
+        results->push_back(chunk);
+        if(softResults != nullptr) {
+            softResults->push_back(softChunk);
+        }
+        chunkPos = 0;
+        chunkMagnitude = 0;
+    }
+}
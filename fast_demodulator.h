@@ -0,0 +1,85 @@
+#ifndef FAST_DEMODULATOR_H
+#define FAST_DEMODULATOR_H
+
+#include <complex>
+#include <vector>
+#include <inmarsatc_demodulator.h>
+#include "sample_convert.h"
+
+#define FASTDEMOD_SYMBOL_RATE 1200.0
+//samples per symbol after the matched filter
+#define FASTDEMOD_SPS 4
+//matched filter length in symbols
+#define FASTDEMOD_FILTER_SPAN 8
+#define FASTDEMOD_ROLLOFF 0.4
+#define FASTDEMOD_DEFAULT_LO_FREQ 500
+#define FASTDEMOD_DEFAULT_HI_FREQ 4500
+#define FASTDEMOD_DEFAULT_CENTER_FREQ 2600
+//soft decisions are scaled to -SOFT_SYMBOL_MAX..SOFT_SYMBOL_MAX
+#define SOFT_SYMBOL_MAX 127
+
+//soft decisions of one chunk of symbols, positive for symbol 1
+struct SoftChunk {
+    int8_t symbols[DEMODULATOR_SYMBOLSPERCHUNK];
+};
+
+//single-precision BPSK demodulator: NCO mixer, decimating root raised cosine matched filter,
+//gardner symbol timing recovery and costas carrier loop with fll assist
+//returns the same demodulator_result chunks as inmarsatc::demodulator::Demodulator
+class FastDemodulator {
+public:
+    FastDemodulator(double sampleRate = 48000);
+    //soft gets one chunk of soft decisions for every returned chunk, if not nullptr
+    std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> demodulate(std::complex<double>* samples, int length, std::vector<SoftChunk>* soft = nullptr);
+    void setLowFreq(double freq);
+    void setHighFreq(double freq);
+    void setCenterFreq(double freq);
+    double getCenterFreq();
+    bool getIsInSync();
+    //name of the selected simd kernels("avx", "sse3" or "scalar")
+    static const char* getKernelName();
+
+private:
+    void processFilterOutput(std::complex<float> y, std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>* results);
+    void processSymbol(std::complex<float> strobe, std::vector<inmarsatc::demodulator::Demodulator::demodulator_result>* results);
+    std::complex<float> interpolate(double t);
+
+    double sampleRate;
+    double loFreq;
+    double hiFreq;
+    double ncoFreq;
+    double ncoPhase;
+    //frequency correction of the carrier loop in radians per symbol, moved to the nco after each block
+    double loopFreq;
+    int decimation;
+    double sps;
+    //interleaved complex history + current block, and interleaved(re/im duplicated) filter taps
+    AlignedBuffer<float> work;
+    AlignedBuffer<float> taps;
+    int tapsCount;
+    int tapsFloats;
+    int workLen;
+    int decimPhase;
+    //matched filter outputs used by the timing interpolator
+    std::complex<float> filtered[16];
+    long long filteredCount;
+    double timingNext;
+    double timingIntegrator;
+    std::complex<float> prevStrobe;
+    std::complex<float> prevSquared;
+    //carrier loop
+    double phase;
+    double agc;
+    double lockMetric;
+    bool isInSync;
+    double alpha;
+    double beta;
+    //output chunk
+    inmarsatc::demodulator::Demodulator::demodulator_result chunk;
+    SoftChunk softChunk;
+    std::vector<SoftChunk>* softResults;
+    int chunkPos;
+    double chunkMagnitude;
+};
+
+#endif // FAST_DEMODULATOR_H
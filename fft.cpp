@@ -0,0 +1,47 @@
+#include "fft.h"
+#include <cmath>
+
+Fft::Fft(int size) {
+    this->size = size;
+    int bits = 0;
+    while((1 << bits) < size) {
+        bits++;
+    }
+    reversed.resize(size);
+    for(int i = 0; i < size; i++) {
+        int r = 0;
+        for(int b = 0; b < bits; b++) {
+            if(i & (1 << b)) {
+                r |= 1 << (bits - 1 - b);
+            }
+        }
+        reversed[i] = r;
+    }
+    twiddles.resize(size / 2);
+    for(int i = 0; i < size / 2; i++) {
+        twiddles[i] = std::polar(1.0, -2 * M_PI * i / size);
+    }
+}
+
+void Fft::transform(std::complex<double>* data) {
+    for(int i = 0; i < size; i++) {
+        if(i < reversed[i]) {
+            std::swap(data[i], data[reversed[i]]);
+        }
+    }
+    for(int len = 2; len <= size; len <<= 1) {
+        int half = len / 2;
+        int step = size / len;
+        for(int start = 0; start < size; start += len) {
+            for(int k = 0; k < half; k++) {
+                std::complex<double> t = data[start + k + half] * twiddles[k * step];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
+
+int Fft::getSize() {
+    return size;
+}
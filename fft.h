@@ -0,0 +1,20 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+//in-place radix-2 complex fft with precomputed twiddles and bit reversal table
+class Fft {
+public:
+    //size must be power of 2
+    Fft(int size);
+    void transform(std::complex<double>* data);
+    int getSize();
+private:
+    int size;
+    std::vector<int> reversed;
+    std::vector<std::complex<double>> twiddles;
+};
+
+#endif // FFT_H
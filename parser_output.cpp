@@ -0,0 +1,373 @@
+#include "parser_output.h"
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <json.hpp> //https://github.com/nlohmann/json
+
+using json = nlohmann::json;
+
+void sendParserDataViaUdp(std::string data, int sockfd, sockaddr_in serveraddr) {
+    sendto(sockfd, data.c_str(), data.size(), 0, (const struct sockaddr *) &serveraddr, sizeof(serveraddr));
+}
+
+bool ifPacketIsMessage(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res) {
+    switch(pack_dec_res.decoding_result.packetDescriptor) {
+        case 0xA3:
+        case 0xA8:
+            return pack_dec_res.decoding_result.packetVars.find("shortMessage") != pack_dec_res.decoding_result.packetVars.end();
+        case 0xAA:
+        case 0xB1:
+        case 0xB2:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void printFrameParserPacket(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res, bool isFrameParserPrintAllPackets,  bool isFrameParserVerbose) {
+    if(isFrameParserPrintAllPackets || ifPacketIsMessage(pack_dec_res)) {
+        std::cout << "packet:                        " << std::endl;
+        std::cout << "  type: " << pack_dec_res.decoding_result.packetVars["packetDescriptorText"] << std::dec << " (" << std::hex << (uint16_t)pack_dec_res.decoding_result.packetDescriptor << ")" << std::endl;
+        if(isFrameParserVerbose) {
+            std::cout << "  frameNumber: " << pack_dec_res.decoding_result.frameNumber << std::endl;
+            std::time_t timestamp = std::chrono::high_resolution_clock::to_time_t(pack_dec_res.decoding_result.timestamp);
+            std::cout << "  timestamp: " << std::ctime(&timestamp);
+            std::cout << "  decodingStage: " << (pack_dec_res.decoding_result.decodingStage == PACKETDECODER_DECODING_STAGE_NONE ? "none" : (pack_dec_res.decoding_result.decodingStage == PACKETDECODER_DECODING_STAGE_COMPLETE ? "complete" : "partial")) << std::endl;
+            std::cout << "  packetLength: " << pack_dec_res.decoding_result.packetLength << std::endl;
+            bool payload = pack_dec_res.decoding_result.payload.presentation != -1;
+            std::cout << "  payload: " << (payload ? "yes" : "no") << std::endl;
+            if(payload) {
+                std::cout << "      presentation: " << (pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_BINARY ? "binary" : (pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_IA5 ? "IA5" : (pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_ITA2 ? "ITA2" : "unknown"))) << std::endl;
+                std::cout << "      data: {" << std::endl << "          ";
+                if(pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_IA5) {
+                    for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                        char chr = pack_dec_res.decoding_result.payload.data8Bit[i] & 0b01111111;
+                        if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                            std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                        } else if(chr != '\n' && chr != '\r') {
+                            std::cout << chr;
+                        } else {
+                            std::cout << std::endl << "         ";
+                        }
+                    }
+                } else if(pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_ITA2) {
+
+                } else {
+                    for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                        uint8_t data = pack_dec_res.decoding_result.payload.data8Bit[i];
+                        std::cout << std::hex << (uint16_t)data << std::dec << " ";
+                    }
+                }
+                std::cout << std::endl << "      }" << std::endl;
+            }
+            std::cout << "  packetVars:" << std::endl;
+            for(std::map<std::string, std::string>::const_iterator it = pack_dec_res.decoding_result.packetVars.begin(); it != pack_dec_res.decoding_result.packetVars.end(); ++it) {
+                std::string key = it->first;
+                std::string data = it->second;
+                if(key == "packetDescriptorText") {
+                    continue;
+                }
+                std::cout << "      " << key << ": " << std::endl << "          ";
+                for(int k = 0; k < (int)data.length(); k++) {
+                    if(data[k] != '\n') {
+                        std::cout << data[k];
+                    } else {
+                        std::cout << std::endl << "          ";
+                    }
+                }
+                std::cout << std::endl;
+            }
+        } else {
+            switch(pack_dec_res.decoding_result.packetDescriptor) {
+                case 0x27:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << std::endl;
+                    }
+                    break;
+                case 0x2A:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << std::endl;
+                    }
+                    break;
+                case 0x08:
+                    {
+                        std::cout << "  sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << " ULF: " << pack_dec_res.decoding_result.packetVars["uplinkChannelMhz"] << std::endl;
+                    }
+                    break;
+                case 0x6C:
+                    {
+                        std::cout << "  ULF: " << pack_dec_res.decoding_result.packetVars["uplinkChannelMhz"] << std::endl;
+                        std::cout << "  Services: ";
+                        std::string services = pack_dec_res.decoding_result.packetVars["services"];
+                        for(int k = 0; k < (int)services.length(); k++) {
+                            if(services[k] != '\n') {
+                                std::cout << services[k];
+                            } else {
+                                std::cout << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                        std::cout << "  Tdm slots: ";
+                        std::string tdmSlots = pack_dec_res.decoding_result.packetVars["tdmSlots"];
+                        for(int k = 0; k < (int)tdmSlots.length(); k++) {
+                            if(tdmSlots[k] != '\n') {
+                                std::cout << tdmSlots[k];
+                            } else {
+                                std::cout << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0x7D:
+                    {
+                        std::cout << "  netVer: " << pack_dec_res.decoding_result.packetVars["networkVersion"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " sigCh: " << pack_dec_res.decoding_result.packetVars["signallingChannel"] << " count: " << pack_dec_res.decoding_result.packetVars["count"] << " chType: " << pack_dec_res.decoding_result.packetVars["channelTypeName"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " local: " << pack_dec_res.decoding_result.packetVars["local"] << " randInt: " << pack_dec_res.decoding_result.packetVars["randomInterval"] << std::endl;
+                        std::cout << "  Status: ";
+                        std::string status = pack_dec_res.decoding_result.packetVars["status"];
+                        for(int k = 0; k < (int)status.length(); k++) {
+                            if(status[k] != '\n') {
+                                std::cout << status[k];
+                            } else {
+                                std::cout << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                        std::cout << "  Services: ";
+                        std::string services = pack_dec_res.decoding_result.packetVars["services"];
+                        for(int k = 0; k < (int)services.length(); k++) {
+                            if(services[k] != '\n') {
+                                std::cout << services[k];
+                            } else {
+                                std::cout << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0x81:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << " dlFr: " << pack_dec_res.decoding_result.packetVars["downlinkChannelMhz"] << " pres: " << pack_dec_res.decoding_result.packetVars["presentation"] << std::endl;
+                    }
+                    break;
+                case 0x83:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " status: " << pack_dec_res.decoding_result.packetVars["status_bits"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << " frLen: " << pack_dec_res.decoding_result.packetVars["frameLength"] << " dur: " << pack_dec_res.decoding_result.packetVars["duration"] << " dlFr: " << pack_dec_res.decoding_result.packetVars["downlinkChannelMhz"] << " ulFr: " << pack_dec_res.decoding_result.packetVars["uplinkChannelMhz"] << " frOffs: " << pack_dec_res.decoding_result.packetVars["frameOffset"] << " PD1: " << pack_dec_res.decoding_result.packetVars["packetDescriptor1"] << std::endl;
+                    }
+                    break;
+                case 0x91:
+                    {
+                        //not implemented
+                    }
+                    break;
+                case 0x92:
+                    {
+                        std::cout << "  loginAckLen: " << pack_dec_res.decoding_result.packetVars["loginAckLength"] << " dlFr: " << pack_dec_res.decoding_result.packetVars["downlinkChannelMhz"] << " les: " << pack_dec_res.decoding_result.packetVars["les"] << " stStartHex: " << pack_dec_res.decoding_result.packetVars["stationStartHex"] << std::endl;
+                        if(pack_dec_res.decoding_result.packetVars.find("stationCount") != pack_dec_res.decoding_result.packetVars.end()) {
+                            std::cout << "  stationCnt: " << pack_dec_res.decoding_result.packetVars["stationCount"] << " Stations: ";
+                            std::string stations = pack_dec_res.decoding_result.packetVars["stations"];
+                            for(int k = 0; k < (int)stations.length(); k++) {
+                                if(stations[k] != '\n') {
+                                    std::cout << stations[k];
+                                } else {
+                                    std::cout << " ";
+                                }
+                            }
+                            std::cout << std::endl;
+                        }
+                    }
+                    break;
+                case 0x9A:
+                    {
+                        //not implemented
+                    }
+                    break;
+                case 0xA0:
+                    {
+                        //not implemented
+                    }
+                    break;
+                case 0xA3:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"]<< std::endl;
+                        if(pack_dec_res.decoding_result.packetVars.find("shortMessage") != pack_dec_res.decoding_result.packetVars.end()) {
+                            std::cout << "  Short message: " << std::endl << "      ";
+                            std::string shortMessage = pack_dec_res.decoding_result.packetVars["shortMessage"];
+                            for(int k = 0; k < (int)shortMessage.length(); k++) {
+                                char chr = shortMessage[k] & 0x7F;
+                                if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                                    std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                                } else if(chr != '\n'  && chr != '\r') {
+                                    std::cout << chr;
+                                } else {
+                                    std::cout << std::endl << "     ";
+                                }
+                            }
+                            std::cout << std::endl;
+                        }
+                    }
+                    break;
+                case 0xA8:
+                    {
+                        std::cout << "  msgId: " << pack_dec_res.decoding_result.packetVars["mesId"] << " sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"]<< std::endl;
+                        if(pack_dec_res.decoding_result.packetVars.find("shortMessage") != pack_dec_res.decoding_result.packetVars.end()) {
+                            std::cout << "  Short message: " << std::endl << "      ";
+                            std::string shortMessage = pack_dec_res.decoding_result.packetVars["shortMessage"];
+                            for(int k = 0; k < (int)shortMessage.length(); k++) {
+                                char chr = shortMessage[k] & 0x7F;
+                                if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                                    std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                                } else if(chr != '\n'  && chr != '\r') {
+                                    std::cout << chr;
+                                } else {
+                                    std::cout << std::endl << "     ";
+                                }
+                            }
+                            std::cout << std::endl;
+                        }
+                    }
+                    break;
+                case 0xAA:
+                    {
+                        std::cout << "  sat: " << pack_dec_res.decoding_result.packetVars["satName"] << " les: " << pack_dec_res.decoding_result.packetVars["lesName"] << " LCN: " << pack_dec_res.decoding_result.packetVars["logicalChannelNo"] << " packetNo: " << pack_dec_res.decoding_result.packetVars["packetNo"] << std::endl;
+                        bool isBinary = pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_BINARY;
+                        std::cout << "  Message(" << (isBinary ? "hex" : "text") << "): " << std::endl << "     ";
+                        if(pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_IA5) {
+                            for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                                char chr = pack_dec_res.decoding_result.payload.data8Bit[i] & 0x7F;
+                                if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                                    std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                                } else if(chr != '\n' && chr != '\r') {
+                                    std::cout << chr;
+                                } else {
+                                    std::cout << std::endl << "         ";
+                                }
+                            }
+                        } else if(pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_ITA2) {
+
+                        } else {
+                            for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                                uint8_t data = pack_dec_res.decoding_result.payload.data8Bit[i];
+                                std::cout << std::hex << (uint16_t)data << std::dec << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0xAB:
+                    {
+                        std::cout << "  lesListLen: " << pack_dec_res.decoding_result.packetVars["lesListLength"] << " stStartHex: " << pack_dec_res.decoding_result.packetVars["stationStartHex"] << " stCnt: " << pack_dec_res.decoding_result.packetVars["stationCount"] << std::endl;
+                        std::cout << " Stations: ";
+                        std::string stations = pack_dec_res.decoding_result.packetVars["stations"];
+                        for(int k = 0; k < (int)stations.length(); k++) {
+                            if(stations[k] != '\n') {
+                                std::cout << stations[k];
+                            } else {
+                                std::cout << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0xAC:
+                    {
+                        //not implemented
+                    }
+                    break;
+                case 0xAD:
+                    {
+                        //not implemented
+                    }
+                    break;
+                case 0xB1:
+                    {
+                        std::cout << "  msgType: " << pack_dec_res.decoding_result.packetVars["messageType"] << " svcCd&AddrName: " << pack_dec_res.decoding_result.packetVars["serviceCodeAndAddressName"] << " contin: " << pack_dec_res.decoding_result.packetVars["continuation"] << " prio: " << pack_dec_res.decoding_result.packetVars["priorityText"] << " rep: " << pack_dec_res.decoding_result.packetVars["repetition"] << " msgId: " << pack_dec_res.decoding_result.packetVars["messageId"] << " packetNo: " << pack_dec_res.decoding_result.packetVars["packetNo"] << " isNewPayl: " << pack_dec_res.decoding_result.packetVars["isNewPayload"] << " addrHex: " << pack_dec_res.decoding_result.packetVars["addressHex"] << std::endl;
+                        bool isBinary = pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_BINARY;
+                        std::cout << "  Payload(" << (isBinary ? "hex" : "text") << "): " << std::endl << "     ";
+                        if(!isBinary) {
+                            for(int k = 0; k < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); k++) {
+                                char chr = pack_dec_res.decoding_result.payload.data8Bit[k] & 0x7F;
+                                if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                                    std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                                } else if(chr != '\n'  && chr != '\r') {
+                                    std::cout << chr;
+                                } else {
+                                    std::cout << std::endl << "     ";
+                                }
+                            }
+                        } else {
+                            for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                                uint8_t data = pack_dec_res.decoding_result.payload.data8Bit[i];
+                                std::cout << std::hex << (uint16_t)data << std::dec << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0xB2:
+                    {
+                        std::cout << "  msgType: " << pack_dec_res.decoding_result.packetVars["messageType"] << " svcCd&AddrName: " << pack_dec_res.decoding_result.packetVars["serviceCodeAndAddressName"] << " contin: " << pack_dec_res.decoding_result.packetVars["continuation"] << " prio: " << pack_dec_res.decoding_result.packetVars["priorityText"] << " rep: " << pack_dec_res.decoding_result.packetVars["repetition"] << " msgId: " << pack_dec_res.decoding_result.packetVars["messageId"] << " packetNo: " << pack_dec_res.decoding_result.packetVars["packetNo"] << " isNewPayl: " << pack_dec_res.decoding_result.packetVars["isNewPayload"] << " addrHex: " << pack_dec_res.decoding_result.packetVars["addressHex"] << std::endl;
+                        bool isBinary = pack_dec_res.decoding_result.payload.presentation == PACKETDECODER_PRESENTATION_BINARY;
+                        std::cout << "  Payload(" << (isBinary ? "hex" : "text") << "): " << std::endl << "     ";
+                        if(!isBinary) {
+                            for(int k = 0; k < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); k++) {
+                                char chr = pack_dec_res.decoding_result.payload.data8Bit[k] & 0x7F;
+                                if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+                                    std::cout << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+                                } else if(chr != '\n'  && chr != '\r') {
+                                    std::cout << chr;
+                                } else {
+                                    std::cout << std::endl << "     ";
+                                }
+                            }
+                        } else {
+                            for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+                                uint8_t data = pack_dec_res.decoding_result.payload.data8Bit[i];
+                                std::cout << std::hex << (uint16_t)data << std::dec << " ";
+                            }
+                        }
+                        std::cout << std::endl;
+                    }
+                    break;
+                case 0xBD:
+                    {
+                        //nothing
+                    }
+                    break;
+                case 0xBE:
+                    {
+                        //nothing
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+std::string frameParserPacketToJson(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res) {
+    json j;
+    j["frameNumber"] = pack_dec_res.decoding_result.frameNumber;
+    j["timestamp"] = pack_dec_res.decoding_result.timestamp.time_since_epoch().count();
+    j["packetDescriptor"] = pack_dec_res.decoding_result.packetDescriptor;
+    j["packetLength"] = pack_dec_res.decoding_result.packetLength;
+    j["decodingStage"] = pack_dec_res.decoding_result.decodingStage == PACKETDECODER_DECODING_STAGE_COMPLETE ? "Complete" : (pack_dec_res.decoding_result.decodingStage == PACKETDECODER_DECODING_STAGE_PARTIAL ? "Partial" : "None");
+    j["payload"]["presentation"] = pack_dec_res.decoding_result.payload.presentation;
+    std::ostringstream os;
+    for(int i = 0; i < (int)pack_dec_res.decoding_result.payload.data8Bit.size(); i++) {
+        char chr = pack_dec_res.decoding_result.payload.data8Bit[i] & 0b01111111;
+        if((chr < 0x20 && chr != '\n' && chr != '\r')) {
+            os << "(" << std::hex << (uint16_t)chr << std::dec << ")";
+        } else if(chr != '\n' && chr != '\r') {
+            os << chr;
+        } else {
+            os << std::endl;
+        }
+    }
+    std::string payload_data = os.str();
+    j["payload"]["data"] = payload_data;
+    j["packetVars"] = pack_dec_res.decoding_result.packetVars;
+    return j.dump(-1, ' ', false, json::error_handler_t::ignore);
+}
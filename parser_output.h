@@ -0,0 +1,13 @@
+#ifndef PARSER_OUTPUT_H
+#define PARSER_OUTPUT_H
+
+#include <string>
+#include <netinet/in.h>
+#include <inmarsatc_parser.h>
+
+void sendParserDataViaUdp(std::string data, int sockfd, sockaddr_in serveraddr);
+bool ifPacketIsMessage(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res);
+void printFrameParserPacket(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res, bool isFrameParserPrintAllPackets,  bool isFrameParserVerbose);
+std::string frameParserPacketToJson(inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res);
+
+#endif // PARSER_OUTPUT_H
@@ -0,0 +1,95 @@
+#include "prescan.h"
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "sample_source.h"
+
+bool prescanRecording(std::map<std::string, std::string> params, double thresholdDb, std::vector<SignalRegion>* regions, PrescanStats* stats) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::unique_ptr<SampleSource> source(createSampleSource(params));
+    if(!source) {
+        return false;
+    }
+    long long length = source->getLength();
+    double rate = source->getSampleRate();
+    if(length <= 0 || !source->seek(0)) {
+        std::cout << "Prescan requires a recording as the source!" << std::endl;
+        return false;
+    }
+    double loFreq = params.find("demodLoFreq") != params.end() ? std::atoi(params["demodLoFreq"].c_str()) : 500;
+    double hiFreq = params.find("demodHiFreq") != params.end() ? std::atoi(params["demodHiFreq"].c_str()) : 4500;
+    if(params.find("demodSourceHilbertDecim") != params.end() && std::atoi(params["demodSourceHilbertDecim"].c_str()) > 1) {
+        //decimated source is already shifted by the center frequency
+        double centFreq = params.find("demodCentFreq") != params.end() ? std::atoi(params["demodCentFreq"].c_str()) : DEMOD_DEFAULT_CENTER_FREQ;
+        loFreq -= centFreq;
+        hiFreq -= centFreq;
+    }
+    CarrierDetector detector(rate, loFreq, hiFreq);
+    if(!detector.isValid()) {
+        std::cout << "Prescan band is too narrow!" << std::endl;
+        return false;
+    }
+    std::vector<std::complex<double>> collected;
+    long long blockLength = PRESCAN_BLOCK_SECONDS * rate;
+    int blocks = (length + blockLength - 1) / blockLength;
+    std::vector<bool> present(blocks, false);
+    for(int b = 0; b < blocks; b++) {
+        long long blockEnd = std::min(length, (b + 1) * blockLength);
+        if(!source->seek(b * blockLength)) {
+            break;
+        }
+        //first read after seek holds the transient of the processing stages
+        std::complex<double>* samples;
+        int count = source->read(&samples);
+        long long position = b * blockLength + std::max(count, 0);
+        collected.clear();
+        while(count > 0 && (int)collected.size() < CARRIER_FFT_SIZE * PRESCAN_FFTS && position < blockEnd) {
+            count = source->read(&samples);
+            count = std::min((long long)count, blockEnd - position);
+            if(count > 0) {
+                collected.insert(collected.end(), samples, samples + count);
+                position += count;
+            }
+        }
+        int ffts = std::min((int)collected.size() / CARRIER_FFT_SIZE, PRESCAN_FFTS);
+        if(ffts == 0) {
+            //too short tail of the recording, same as the previous block
+            present[b] = b > 0 && present[b - 1];
+            continue;
+        }
+        detector.reset();
+        for(int f = 0; f < ffts; f++) {
+            detector.addWindow(collected.data() + f * CARRIER_FFT_SIZE);
+        }
+        double freq, ratioDb;
+        present[b] = detector.getPeak(&freq, &ratioDb) && ratioDb >= thresholdDb;
+    }
+    regions->clear();
+    long long pad = PRESCAN_PAD_SECONDS * rate;
+    int presentBlocks = 0;
+    for(int b = 0; b < blocks; b++) {
+        if(!present[b]) {
+            continue;
+        }
+        presentBlocks++;
+        SignalRegion region;
+        region.start = std::max(0LL, b * blockLength - pad);
+        region.end = std::min(length, (b + 1) * blockLength + pad);
+        if(!regions->empty() && region.start <= regions->back().end) {
+            regions->back().end = region.end;
+        } else {
+            regions->push_back(region);
+        }
+    }
+    long long presentLength = 0;
+    for(size_t r = 0; r < regions->size(); r++) {
+        presentLength += (*regions)[r].end - (*regions)[r].start;
+    }
+    stats->blocks = blocks;
+    stats->presentBlocks = presentBlocks;
+    stats->recordingSeconds = length / rate;
+    stats->presentSeconds = presentLength / rate;
+    stats->wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
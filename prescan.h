@@ -0,0 +1,30 @@
+#ifndef PRESCAN_H
+#define PRESCAN_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "sample_frontend.h"
+#include "acquisition.h"
+
+//recording is judged in blocks of this length
+#define PRESCAN_BLOCK_SECONDS 2
+//only PRESCAN_FFTS windows of CARRIER_FFT_SIZE samples of each block are analyzed
+#define PRESCAN_FFTS 8
+#define PRESCAN_DEFAULT_THRESHOLD CARRIER_DEFAULT_THRESHOLD
+//added around each region with carrier, also gives the demodulator time to get in sync
+#define PRESCAN_PAD_SECONDS 10
+
+struct PrescanStats {
+    int blocks;
+    int presentBlocks;
+    double recordingSeconds;
+    double presentSeconds;
+    double wallSeconds;
+};
+
+//finds regions of the recording selected in params with bpsk carrier between --lo-freq and --hi-freq(see CarrierDetector)
+//returns false if the source is not a seekable recording
+bool prescanRecording(std::map<std::string, std::string> params, double thresholdDb, std::vector<SignalRegion>* regions, PrescanStats* stats);
+
+#endif // PRESCAN_H
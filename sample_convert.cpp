@@ -0,0 +1,534 @@
+#include "sample_convert.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAMPLE_CONVERT_X86
+#endif
+
+#define S24_SCALE (1.0 / 256.0)
+#define F32_SCALE 32768.0
+//unsigned 8 bit iq(rtl-sdr) is centered at 127.5
+#define U8_OFFSET 127.5
+#define U8_SCALE 256.0
+
+typedef void (*convertKernel)(const void* in, std::complex<double>* out, int count);
+typedef void (*measureKernel)(const std::complex<double>* in, int count, LevelStats* stats);
+typedef void (*applyKernel)(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step);
+
+int sampleFormatSize(SampleFormat format) {
+    switch(format) {
+        case SAMPLE_FORMAT_S16:
+            return 2;
+        case SAMPLE_FORMAT_S24:
+        case SAMPLE_FORMAT_F32:
+            return 4;
+    }
+    return 2;
+}
+
+bool parseSampleFormat(std::string name, SampleFormat* format) {
+    if(name == "s16") {
+        *format = SAMPLE_FORMAT_S16;
+    } else if(name == "s24") {
+        *format = SAMPLE_FORMAT_S24;
+    } else if(name == "f32") {
+        *format = SAMPLE_FORMAT_F32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseIqFormat(std::string name, SampleFormat* format) {
+    if(name == "s16le") {
+        *format = SAMPLE_FORMAT_S16;
+    } else if(name == "f32le") {
+        *format = SAMPLE_FORMAT_F32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//scalar kernels, also used for the tails of simd kernels
+
+static inline int32_t s24ToInt(int32_t val) {
+    return (int32_t)((uint32_t)val << 8) >> 8;
+}
+
+static void convertS16Scalar(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    for(int i = 0; i < count; i++) {
+        double val = buf[i];
+        out[i] = std::complex<double>(val, val);
+    }
+}
+
+static void convertS24Scalar(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    for(int i = 0; i < count; i++) {
+        double val = s24ToInt(buf[i]) * S24_SCALE;
+        out[i] = std::complex<double>(val, val);
+    }
+}
+
+static void convertF32Scalar(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    for(int i = 0; i < count; i++) {
+        double val = buf[i] * F32_SCALE;
+        out[i] = std::complex<double>(val, val);
+    }
+}
+
+//iq kernels convert 2*count values to doubles without duplication
+
+static void convertIqS16Scalar(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    for(int i = 0; i < count; i++) {
+        out[i] = std::complex<double>(buf[i * 2], buf[i * 2 + 1]);
+    }
+}
+
+static void convertIqS24Scalar(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    for(int i = 0; i < count; i++) {
+        out[i] = std::complex<double>(s24ToInt(buf[i * 2]) * S24_SCALE, s24ToInt(buf[i * 2 + 1]) * S24_SCALE);
+    }
+}
+
+static void convertIqF32Scalar(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    for(int i = 0; i < count; i++) {
+        out[i] = std::complex<double>(buf[i * 2] * F32_SCALE, buf[i * 2 + 1] * F32_SCALE);
+    }
+}
+
+static void convertIqU8Scalar(const void* in, std::complex<double>* out, int count) {
+    const uint8_t* buf = (const uint8_t*)in;
+    for(int i = 0; i < count; i++) {
+        out[i] = std::complex<double>((buf[i * 2] - U8_OFFSET) * U8_SCALE, (buf[i * 2 + 1] - U8_OFFSET) * U8_SCALE);
+    }
+}
+
+static void measureLevelScalar(const std::complex<double>* in, int count, LevelStats* stats) {
+    std::complex<double> sum = 0;
+    double power = 0;
+    int clipped = 0;
+    int nearFull = 0;
+    for(int i = 0; i < count; i++) {
+        sum += in[i];
+        power += std::norm(in[i]);
+        double peak = std::max(std::fabs(in[i].real()), std::fabs(in[i].imag()));
+        clipped += peak >= LEVEL_CLIP;
+        nearFull += peak >= LEVEL_NEAR_FULL;
+    }
+    stats->sum += sum;
+    stats->power += power;
+    stats->clipped += clipped;
+    stats->nearFull += nearFull;
+}
+
+static void applyLevelScalar(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step) {
+    for(int i = 0; i < count; i++) {
+        buf[i] = (buf[i] - dc) * gain;
+        gain += step;
+    }
+}
+
+#ifdef SAMPLE_CONVERT_X86
+
+//stores 2 doubles as 2 complex(val,val)
+__attribute__((target("sse2")))
+static inline void storeDupSse2(double* out, __m128d v) {
+    _mm_storeu_pd(out, _mm_unpacklo_pd(v, v));
+    _mm_storeu_pd(out + 2, _mm_unpackhi_pd(v, v));
+}
+
+__attribute__((target("sse2")))
+static void convertS16Sse2(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    double* dst = (double*)out;
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(buf + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        storeDupSse2(dst + i * 2, _mm_cvtepi32_pd(lo));
+        storeDupSse2(dst + i * 2 + 4, _mm_cvtepi32_pd(_mm_srli_si128(lo, 8)));
+        storeDupSse2(dst + i * 2 + 8, _mm_cvtepi32_pd(hi));
+        storeDupSse2(dst + i * 2 + 12, _mm_cvtepi32_pd(_mm_srli_si128(hi, 8)));
+    }
+    convertS16Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertS24Sse2(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    double* dst = (double*)out;
+    const __m128d scale = _mm_set1_pd(S24_SCALE);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(buf + i));
+        s = _mm_srai_epi32(_mm_slli_epi32(s, 8), 8);
+        storeDupSse2(dst + i * 2, _mm_mul_pd(_mm_cvtepi32_pd(s), scale));
+        storeDupSse2(dst + i * 2 + 4, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(s, 8)), scale));
+    }
+    convertS24Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertF32Sse2(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    double* dst = (double*)out;
+    const __m128d scale = _mm_set1_pd(F32_SCALE);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 s = _mm_loadu_ps(buf + i);
+        storeDupSse2(dst + i * 2, _mm_mul_pd(_mm_cvtps_pd(s), scale));
+        storeDupSse2(dst + i * 2 + 4, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(s, s)), scale));
+    }
+    convertF32Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertIqS16Sse2(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    double* dst = (double*)out;
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(buf + i * 2));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_pd(dst + i * 2, _mm_cvtepi32_pd(lo));
+        _mm_storeu_pd(dst + i * 2 + 2, _mm_cvtepi32_pd(_mm_srli_si128(lo, 8)));
+        _mm_storeu_pd(dst + i * 2 + 4, _mm_cvtepi32_pd(hi));
+        _mm_storeu_pd(dst + i * 2 + 6, _mm_cvtepi32_pd(_mm_srli_si128(hi, 8)));
+    }
+    convertIqS16Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertIqS24Sse2(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    double* dst = (double*)out;
+    const __m128d scale = _mm_set1_pd(S24_SCALE);
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(buf + i * 2));
+        s = _mm_srai_epi32(_mm_slli_epi32(s, 8), 8);
+        _mm_storeu_pd(dst + i * 2, _mm_mul_pd(_mm_cvtepi32_pd(s), scale));
+        _mm_storeu_pd(dst + i * 2 + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(s, 8)), scale));
+    }
+    convertIqS24Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertIqF32Sse2(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    double* dst = (double*)out;
+    const __m128d scale = _mm_set1_pd(F32_SCALE);
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128 s = _mm_loadu_ps(buf + i * 2);
+        _mm_storeu_pd(dst + i * 2, _mm_mul_pd(_mm_cvtps_pd(s), scale));
+        _mm_storeu_pd(dst + i * 2 + 2, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(s, s)), scale));
+    }
+    convertIqF32Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void convertIqU8Sse2(const void* in, std::complex<double>* out, int count) {
+    const uint8_t* buf = (const uint8_t*)in;
+    double* dst = (double*)out;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128d offset = _mm_set1_pd(U8_OFFSET);
+    const __m128d scale = _mm_set1_pd(U8_SCALE);
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(buf + i * 2));
+        __m128i words[2] = {_mm_unpacklo_epi8(s, zero), _mm_unpackhi_epi8(s, zero)};
+        for(int w = 0; w < 2; w++) {
+            __m128i lo = _mm_unpacklo_epi16(words[w], zero);
+            __m128i hi = _mm_unpackhi_epi16(words[w], zero);
+            double* d = dst + i * 2 + w * 8;
+            _mm_storeu_pd(d, _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(lo), offset), scale));
+            _mm_storeu_pd(d + 2, _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), offset), scale));
+            _mm_storeu_pd(d + 4, _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(hi), offset), scale));
+            _mm_storeu_pd(d + 6, _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), offset), scale));
+        }
+    }
+    convertIqU8Scalar(buf + i * 2, out + i, count - i);
+}
+
+//two samples per iteration, the counts are kept in vectors: peak of the two samples is max(|re|, |im|) of
+//unpacked real and imaginary parts, and a true compare is -1 in every lane
+__attribute__((target("sse2")))
+static void measureLevelSse2(const std::complex<double>* in, int count, LevelStats* stats) {
+    const double* src = (const double*)in;
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d clip = _mm_set1_pd(LEVEL_CLIP);
+    const __m128d nearFull = _mm_set1_pd(LEVEL_NEAR_FULL);
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    __m128d power0 = _mm_setzero_pd();
+    __m128d power1 = _mm_setzero_pd();
+    __m128i clipped = _mm_setzero_si128();
+    __m128i near = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128d v0 = _mm_loadu_pd(src + i * 2);
+        __m128d v1 = _mm_loadu_pd(src + i * 2 + 2);
+        sum0 = _mm_add_pd(sum0, v0);
+        sum1 = _mm_add_pd(sum1, v1);
+        power0 = _mm_add_pd(power0, _mm_mul_pd(v0, v0));
+        power1 = _mm_add_pd(power1, _mm_mul_pd(v1, v1));
+        __m128d a0 = _mm_and_pd(v0, absMask);
+        __m128d a1 = _mm_and_pd(v1, absMask);
+        __m128d peak = _mm_max_pd(_mm_unpacklo_pd(a0, a1), _mm_unpackhi_pd(a0, a1));
+        clipped = _mm_sub_epi64(clipped, _mm_castpd_si128(_mm_cmpge_pd(peak, clip)));
+        near = _mm_sub_epi64(near, _mm_castpd_si128(_mm_cmpge_pd(peak, nearFull)));
+    }
+    double s[2];
+    double p[2];
+    int64_t c[2];
+    int64_t n[2];
+    _mm_storeu_pd(s, _mm_add_pd(sum0, sum1));
+    _mm_storeu_pd(p, _mm_add_pd(power0, power1));
+    _mm_storeu_si128((__m128i*)c, clipped);
+    _mm_storeu_si128((__m128i*)n, near);
+    stats->sum += std::complex<double>(s[0], s[1]);
+    stats->power += p[0] + p[1];
+    stats->clipped += c[0] + c[1];
+    stats->nearFull += n[0] + n[1];
+    measureLevelScalar(in + i, count - i, stats);
+}
+
+__attribute__((target("sse2")))
+static void applyLevelSse2(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step) {
+    double* dst = (double*)buf;
+    const __m128d offset = _mm_set_pd(dc.imag(), dc.real());
+    const __m128d gainStep = _mm_set1_pd(2 * step);
+    __m128d g0 = _mm_set1_pd(gain);
+    __m128d g1 = _mm_set1_pd(gain + step);
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128d v0 = _mm_loadu_pd(dst + i * 2);
+        __m128d v1 = _mm_loadu_pd(dst + i * 2 + 2);
+        _mm_storeu_pd(dst + i * 2, _mm_mul_pd(_mm_sub_pd(v0, offset), g0));
+        _mm_storeu_pd(dst + i * 2 + 2, _mm_mul_pd(_mm_sub_pd(v1, offset), g1));
+        g0 = _mm_add_pd(g0, gainStep);
+        g1 = _mm_add_pd(g1, gainStep);
+    }
+    applyLevelScalar(buf + i, count - i, dc, gain + step * i, step);
+}
+
+__attribute__((target("avx2")))
+static inline void storeDupAvx2(double* out, __m256d v) {
+    _mm256_storeu_pd(out, _mm256_permute4x64_pd(v, 0x50));
+    _mm256_storeu_pd(out + 4, _mm256_permute4x64_pd(v, 0xFA));
+}
+
+__attribute__((target("avx2")))
+static void convertS16Avx2(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    double* dst = (double*)out;
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(buf + i)));
+        storeDupAvx2(dst + i * 2, _mm256_cvtepi32_pd(_mm256_castsi256_si128(s)));
+        storeDupAvx2(dst + i * 2 + 8, _mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)));
+    }
+    convertS16Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertS24Avx2(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    double* dst = (double*)out;
+    const __m256d scale = _mm256_set1_pd(S24_SCALE);
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(buf + i));
+        s = _mm256_srai_epi32(_mm256_slli_epi32(s, 8), 8);
+        storeDupAvx2(dst + i * 2, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(s)), scale));
+        storeDupAvx2(dst + i * 2 + 8, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)), scale));
+    }
+    convertS24Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertF32Avx2(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    double* dst = (double*)out;
+    const __m256d scale = _mm256_set1_pd(F32_SCALE);
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256 s = _mm256_loadu_ps(buf + i);
+        storeDupAvx2(dst + i * 2, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(s)), scale));
+        storeDupAvx2(dst + i * 2 + 8, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)), scale));
+    }
+    convertF32Scalar(buf + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertIqS16Avx2(const void* in, std::complex<double>* out, int count) {
+    const int16_t* buf = (const int16_t*)in;
+    double* dst = (double*)out;
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(buf + i * 2)));
+        _mm256_storeu_pd(dst + i * 2, _mm256_cvtepi32_pd(_mm256_castsi256_si128(s)));
+        _mm256_storeu_pd(dst + i * 2 + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)));
+    }
+    convertIqS16Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertIqS24Avx2(const void* in, std::complex<double>* out, int count) {
+    const int32_t* buf = (const int32_t*)in;
+    double* dst = (double*)out;
+    const __m256d scale = _mm256_set1_pd(S24_SCALE);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(buf + i * 2));
+        s = _mm256_srai_epi32(_mm256_slli_epi32(s, 8), 8);
+        _mm256_storeu_pd(dst + i * 2, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(s)), scale));
+        _mm256_storeu_pd(dst + i * 2 + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)), scale));
+    }
+    convertIqS24Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertIqF32Avx2(const void* in, std::complex<double>* out, int count) {
+    const float* buf = (const float*)in;
+    double* dst = (double*)out;
+    const __m256d scale = _mm256_set1_pd(F32_SCALE);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256 s = _mm256_loadu_ps(buf + i * 2);
+        _mm256_storeu_pd(dst + i * 2, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(s)), scale));
+        _mm256_storeu_pd(dst + i * 2 + 4, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)), scale));
+    }
+    convertIqF32Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convertIqU8Avx2(const void* in, std::complex<double>* out, int count) {
+    const uint8_t* buf = (const uint8_t*)in;
+    double* dst = (double*)out;
+    const __m256d offset = _mm256_set1_pd(U8_OFFSET);
+    const __m256d scale = _mm256_set1_pd(U8_SCALE);
+    int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(buf + i * 2)));
+        _mm256_storeu_pd(dst + i * 2, _mm256_mul_pd(_mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(s)), offset), scale));
+        _mm256_storeu_pd(dst + i * 2 + 4, _mm256_mul_pd(_mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)), offset), scale));
+    }
+    convertIqU8Scalar(buf + i * 2, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void measureLevelAvx2(const std::complex<double>* in, int count, LevelStats* stats) {
+    const double* src = (const double*)in;
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d clip = _mm256_set1_pd(LEVEL_CLIP);
+    const __m256d nearFull = _mm256_set1_pd(LEVEL_NEAR_FULL);
+    __m256d sum = _mm256_setzero_pd();
+    __m256d power = _mm256_setzero_pd();
+    int clipped = 0;
+    int near = 0;
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m256d v = _mm256_loadu_pd(src + i * 2);
+        sum = _mm256_add_pd(sum, v);
+        power = _mm256_add_pd(power, _mm256_mul_pd(v, v));
+        __m256d a = _mm256_and_pd(v, absMask);
+        //bits 0-1 are the first sample, 2-3 the second
+        int c = _mm256_movemask_pd(_mm256_cmp_pd(a, clip, _CMP_GE_OQ));
+        int n = _mm256_movemask_pd(_mm256_cmp_pd(a, nearFull, _CMP_GE_OQ));
+        clipped += ((c & 3) != 0) + ((c & 12) != 0);
+        near += ((n & 3) != 0) + ((n & 12) != 0);
+    }
+    double s[4];
+    double p[4];
+    _mm256_storeu_pd(s, sum);
+    _mm256_storeu_pd(p, power);
+    stats->sum += std::complex<double>(s[0] + s[2], s[1] + s[3]);
+    stats->power += p[0] + p[1] + p[2] + p[3];
+    stats->clipped += clipped;
+    stats->nearFull += near;
+    measureLevelScalar(in + i, count - i, stats);
+}
+
+__attribute__((target("avx2")))
+static void applyLevelAvx2(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step) {
+    double* dst = (double*)buf;
+    const __m256d offset = _mm256_set_pd(dc.imag(), dc.real(), dc.imag(), dc.real());
+    const __m256d gainStep = _mm256_set1_pd(2 * step);
+    __m256d g = _mm256_set_pd(gain + step, gain + step, gain, gain);
+    int i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m256d v = _mm256_loadu_pd(dst + i * 2);
+        _mm256_storeu_pd(dst + i * 2, _mm256_mul_pd(_mm256_sub_pd(v, offset), g));
+        g = _mm256_add_pd(g, gainStep);
+    }
+    applyLevelScalar(buf + i, count - i, dc, gain + step * i, step);
+}
+
+#endif
+
+struct convertKernels {
+    const char* name;
+    convertKernel kernels[3];
+    convertKernel iqKernels[3];
+    convertKernel iqU8Kernel;
+    measureKernel measureLevel;
+    applyKernel applyLevel;
+};
+
+static convertKernels selectKernels() {
+#ifdef SAMPLE_CONVERT_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        convertKernels k = {"avx2", {convertS16Avx2, convertS24Avx2, convertF32Avx2}, {convertIqS16Avx2, convertIqS24Avx2, convertIqF32Avx2}, convertIqU8Avx2, measureLevelAvx2, applyLevelAvx2};
+        return k;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        convertKernels k = {"sse2", {convertS16Sse2, convertS24Sse2, convertF32Sse2}, {convertIqS16Sse2, convertIqS24Sse2, convertIqF32Sse2}, convertIqU8Sse2, measureLevelSse2, applyLevelSse2};
+        return k;
+    }
+#endif
+    convertKernels k = {"scalar", {convertS16Scalar, convertS24Scalar, convertF32Scalar}, {convertIqS16Scalar, convertIqS24Scalar, convertIqF32Scalar}, convertIqU8Scalar, measureLevelScalar, applyLevelScalar};
+    return k;
+}
+
+static const convertKernels& getKernels() {
+    static const convertKernels kernels = selectKernels();
+    return kernels;
+}
+
+void convertRealToComplex(const void* in, SampleFormat format, std::complex<double>* out, int count) {
+    getKernels().kernels[format](in, out, count);
+}
+
+void convertIqToComplex(const void* in, SampleFormat format, std::complex<double>* out, int count) {
+    getKernels().iqKernels[format](in, out, count);
+}
+
+void convertIqU8ToComplex(const uint8_t* in, std::complex<double>* out, int count) {
+    getKernels().iqU8Kernel(in, out, count);
+}
+
+void measureLevel(const std::complex<double>* in, int count, LevelStats* stats) {
+    getKernels().measureLevel(in, count, stats);
+}
+
+void applyLevel(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step) {
+    getKernels().applyLevel(buf, count, dc, gain, step);
+}
+
+const char* getConvertKernelName() {
+    return getKernels().name;
+}
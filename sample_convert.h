@@ -0,0 +1,96 @@
+#ifndef SAMPLE_CONVERT_H
+#define SAMPLE_CONVERT_H
+
+#include <complex>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+//input sample formats; s24 is 24 bit value in 32 bit little endian container(alsa S24_LE, audiofile virtual 24 bit)
+enum SampleFormat {
+    SAMPLE_FORMAT_S16 = 0,
+    SAMPLE_FORMAT_S24 = 1,
+    SAMPLE_FORMAT_F32 = 2
+};
+
+int sampleFormatSize(SampleFormat format);
+//parses "s16", "s24" or "f32"; returns false for unknown format
+bool parseSampleFormat(std::string name, SampleFormat* format);
+
+//parses iq format names "s16le" or "f32le"; returns false for unknown format
+bool parseIqFormat(std::string name, SampleFormat* format);
+
+//converts real samples to std::complex<double>(val,val), scaled to the int16 range regardless of the input format
+void convertRealToComplex(const void* in, SampleFormat format, std::complex<double>* out, int count);
+//converts count interleaved i/q pairs to std::complex<double>(i,q), scaled the same way as convertRealToComplex()
+void convertIqToComplex(const void* in, SampleFormat format, std::complex<double>* out, int count);
+//converts count unsigned 8 bit i/q pairs(rtl-sdr) to std::complex<double>, scaled to the int16 range
+void convertIqU8ToComplex(const uint8_t* in, std::complex<double>* out, int count);
+//samples of every format are scaled to this full scale
+#define SAMPLE_FULL_SCALE 32768.0
+//sample is counted as clipped when any component reaches this
+#define LEVEL_CLIP 32767.0
+//... and as near full scale over this(-1 dBFS)
+#define LEVEL_NEAR_FULL 29204.0
+
+//sums of one block for the level stage
+struct LevelStats {
+    std::complex<double> sum;
+    //sum of |x|^2
+    double power;
+    int clipped;
+    int nearFull;
+};
+
+//measures count samples
+void measureLevel(const std::complex<double>* in, int count, LevelStats* stats);
+//buf = (buf - dc) * gain, gain changes by step every sample
+void applyLevel(std::complex<double>* buf, int count, std::complex<double> dc, double gain, double step);
+//name of the selected conversion kernel("avx2", "sse2" or "scalar")
+const char* getConvertKernelName();
+
+//heap buffer aligned for simd loads/stores, allocated once and reused for every read
+template <typename T>
+class AlignedBuffer {
+public:
+    AlignedBuffer() {
+        ptr = nullptr;
+        len = 0;
+    }
+    AlignedBuffer(size_t count) {
+        ptr = nullptr;
+        len = 0;
+        resize(count);
+    }
+    ~AlignedBuffer() {
+        free(ptr);
+    }
+    void resize(size_t count) {
+        if(count <= len) {
+            return;
+        }
+        free(ptr);
+        void* p = nullptr;
+        if(posix_memalign(&p, 64, count * sizeof(T)) != 0) {
+            p = nullptr;
+        }
+        ptr = (T*)p;
+        len = ptr != nullptr ? count : 0;
+    }
+    T* data() {
+        return ptr;
+    }
+    size_t size() {
+        return len;
+    }
+    T& operator[](size_t i) {
+        return ptr[i];
+    }
+private:
+    AlignedBuffer(const AlignedBuffer&);
+    AlignedBuffer& operator=(const AlignedBuffer&);
+    T* ptr;
+    size_t len;
+};
+
+#endif // SAMPLE_CONVERT_H
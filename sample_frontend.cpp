@@ -0,0 +1,359 @@
+#include "sample_frontend.h"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+HilbertSampleSource::HilbertSampleSource(SampleSource* source, double sampleRate, double shiftFreq, int decimation) {
+    this->source.reset(source);
+    std::vector<double> taps = designHilbert(HILBERT_TAPS);
+    delay = (HILBERT_TAPS - 1) / 2;
+    for(int k = 1; k <= delay; k += 2) {
+        oddTaps.push_back(taps[delay + k]);
+    }
+    capacity = 0;
+    this->sampleRate = sampleRate;
+    this->decimation = decimation;
+    phase = 0;
+    step = 2 * M_PI * shiftFreq / sampleRate;
+    if(decimation > 1) {
+        //keep 90% of the output band
+        decimator.reset(new DecimatingFir(designLowpass(8 * decimation + 1, 0.45 / decimation), decimation));
+    }
+}
+
+int HilbertSampleSource::read(std::complex<double>** samples) {
+    while(true) {
+        std::complex<double>* in;
+        int count = source->read(&in);
+        if(count <= 0) {
+            return count;
+        }
+        if(capacity < (size_t)count) {
+            std::vector<double> tail(2 * delay, 0.0);
+            if(history.data() != nullptr) {
+                memcpy(tail.data(), history.data(), 2 * delay * sizeof(double));
+            }
+            capacity = count;
+            history.resize(2 * delay + capacity);
+            memcpy(history.data(), tail.data(), 2 * delay * sizeof(double));
+            out.resize(capacity);
+        }
+        double* x = history.data();
+        for(int i = 0; i < count; i++) {
+            x[2 * delay + i] = in[i].real();
+        }
+        //output is delayed by the half of the transformer length
+        for(int i = 0; i < count; i++) {
+            out[i] = std::complex<double>(x[delay + i], 0);
+        }
+        for(int t = 0; t < (int)oddTaps.size(); t++) {
+            int k = 2 * t + 1;
+            double h = oddTaps[t];
+            const double* before = x + delay - k;
+            const double* after = x + delay + k;
+            double* im = (double*)out.data() + 1;
+            for(int i = 0; i < count; i++) {
+                im[i * 2] += h * (before[i] - after[i]);
+            }
+        }
+        memmove(x, x + count, 2 * delay * sizeof(double));
+        if(decimation <= 1) {
+            *samples = out.data();
+            return count;
+        }
+        mixDown(out.data(), count, &phase, step);
+        int outputs = decimator->process(out.data(), count, out.data());
+        if(outputs > 0) {
+            *samples = out.data();
+            return outputs;
+        }
+    }
+}
+
+bool HilbertSampleSource::isIq() {
+    return true;
+}
+
+double HilbertSampleSource::getSampleRate() {
+    return sampleRate / decimation;
+}
+
+long long HilbertSampleSource::getLength() {
+    long long length = source->getLength();
+    return length < 0 ? length : length / decimation;
+}
+
+bool HilbertSampleSource::seek(long long sample) {
+    return source->seek(sample * decimation);
+}
+
+std::string HilbertSampleSource::getStats() {
+    return source->getStats();
+}
+
+FrequencyShiftSampleSource::FrequencyShiftSampleSource(SampleSource* source, double sampleRate, double shiftFreq) {
+    this->source.reset(source);
+    phase = 0;
+    //mixDown() with negative step shifts up
+    step = -2 * M_PI * shiftFreq / sampleRate;
+}
+
+int FrequencyShiftSampleSource::read(std::complex<double>** samples) {
+    int count = source->read(samples);
+    if(count > 0) {
+        mixDown(*samples, count, &phase, step);
+    }
+    return count;
+}
+
+bool FrequencyShiftSampleSource::isIq() {
+    return source->isIq();
+}
+
+double FrequencyShiftSampleSource::getSampleRate() {
+    return source->getSampleRate();
+}
+
+long long FrequencyShiftSampleSource::getLength() {
+    return source->getLength();
+}
+
+bool FrequencyShiftSampleSource::seek(long long sample) {
+    return source->seek(sample);
+}
+
+std::string FrequencyShiftSampleSource::getStats() {
+    return source->getStats();
+}
+
+ResampleSampleSource::ResampleSampleSource(SampleSource* source, double outRate) : resampler(source->getSampleRate(), outRate) {
+    this->source.reset(source);
+    this->outRate = outRate;
+}
+
+int ResampleSampleSource::read(std::complex<double>** samples) {
+    while(true) {
+        std::complex<double>* in;
+        int count = source->read(&in);
+        if(count <= 0) {
+            return count;
+        }
+        out.resize(resampler.getMaxOutput(count));
+        int outputs = resampler.process(in, count, out.data());
+        if(outputs > 0) {
+            *samples = out.data();
+            return outputs;
+        }
+    }
+}
+
+bool ResampleSampleSource::isIq() {
+    return source->isIq();
+}
+
+double ResampleSampleSource::getSampleRate() {
+    return outRate;
+}
+
+long long ResampleSampleSource::getLength() {
+    long long length = source->getLength();
+    return length < 0 ? length : (long long)(length * outRate / source->getSampleRate());
+}
+
+bool ResampleSampleSource::seek(long long sample) {
+    return source->seek((long long)(sample * source->getSampleRate() / outRate));
+}
+
+std::string ResampleSampleSource::getStats() {
+    return source->getStats();
+}
+
+LevelSampleSource::LevelSampleSource(SampleSource* source, bool dcBlock, double targetRms) {
+    this->source.reset(source);
+    this->dcBlock = dcBlock;
+    this->targetRms = targetRms;
+    dc = 0;
+    gain = 1;
+    first = true;
+    levelDb = -INFINITY;
+    totalSamples = 0;
+    clipped = 0;
+    nearFull = 0;
+}
+
+int LevelSampleSource::read(std::complex<double>** samples) {
+    int count = source->read(samples);
+    if(count <= 0) {
+        return count;
+    }
+    LevelStats stats;
+    stats.sum = 0;
+    stats.power = 0;
+    stats.clipped = 0;
+    stats.nearFull = 0;
+    measureLevel(*samples, count, &stats);
+    totalSamples += count;
+    clipped += stats.clipped;
+    nearFull += stats.nearFull;
+    double rate = source->getSampleRate();
+    std::complex<double> mean = stats.sum / (double)count;
+    if(dcBlock) {
+        dc = first ? mean : dc + (mean - dc) * (1 - std::exp(-count / (LEVEL_DC_TIME * rate)));
+    }
+    //mean of |x - dc|^2 from the block sums
+    double power = stats.power / count - 2 * (std::conj(dc) * mean).real() + std::norm(dc);
+    //real input is (val,val), so the norm is twice the power of val
+    if(!source->isIq()) {
+        power /= 2;
+    }
+    levelDb = power > 0 ? 10 * std::log10(power) - 20 * std::log10(SAMPLE_FULL_SCALE) : -INFINITY;
+    double newGain = gain;
+    if(targetRms > 0 && power > 0) {
+        double wanted = std::min(targetRms / std::sqrt(power), std::pow(10, LEVEL_MAX_GAIN_DB / 20.0));
+        double time = wanted < gain ? LEVEL_ATTACK_TIME : LEVEL_DECAY_TIME;
+        newGain = first ? wanted : gain + (wanted - gain) * (1 - std::exp(-count / (time * rate)));
+    }
+    if(dcBlock || targetRms > 0) {
+        //gain is ramped over the block, so there are no steps in the signal
+        applyLevel(*samples, count, dc, first ? newGain : gain, first ? 0 : (newGain - gain) / count);
+    }
+    gain = newGain;
+    first = false;
+    return count;
+}
+
+bool LevelSampleSource::isIq() {
+    return source->isIq();
+}
+
+double LevelSampleSource::getSampleRate() {
+    return source->getSampleRate();
+}
+
+long long LevelSampleSource::getLength() {
+    return source->getLength();
+}
+
+bool LevelSampleSource::seek(long long sample) {
+    return source->seek(sample);
+}
+
+std::string LevelSampleSource::getStats() {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1) << " level = " << levelDb << " dBFS";
+    if(targetRms > 0) {
+        os << " gain = " << 20 * std::log10(gain) << " dB";
+    }
+    os << " clipped = " << clipped << " near full = " << nearFull;
+    if(totalSamples > 0) {
+        os << " (" << std::setprecision(3) << 100.0 * nearFull / totalSamples << "%)";
+    }
+    return os.str() + source->getStats();
+}
+
+CaptureSampleSource::CaptureSampleSource(SampleSource* source, std::shared_ptr<CaptureRing> capture) {
+    this->source.reset(source);
+    this->capture = capture;
+    capture->start(source->getSampleRate(), source->isIq() ? 2 : 1);
+}
+
+int CaptureSampleSource::read(std::complex<double>** samples) {
+    int count = source->read(samples);
+    if(count > 0) {
+        capture->push(*samples, count);
+    }
+    return count;
+}
+
+bool CaptureSampleSource::isIq() {
+    return source->isIq();
+}
+
+double CaptureSampleSource::getSampleRate() {
+    return source->getSampleRate();
+}
+
+long long CaptureSampleSource::getLength() {
+    return source->getLength();
+}
+
+bool CaptureSampleSource::seek(long long sample) {
+    return source->seek(sample);
+}
+
+std::string CaptureSampleSource::getStats() {
+    return source->getStats();
+}
+
+BufferSampleSource::BufferSampleSource(double sampleRate, bool iq) {
+    this->sampleRate = sampleRate;
+    this->iq = iq;
+    block = nullptr;
+    count = 0;
+}
+
+void BufferSampleSource::setBlock(std::complex<double>* samples, int count) {
+    block = samples;
+    this->count = count;
+}
+
+int BufferSampleSource::read(std::complex<double>** samples) {
+    int result = count;
+    *samples = block;
+    count = 0;
+    return result;
+}
+
+bool BufferSampleSource::isIq() {
+    return iq;
+}
+
+double BufferSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+RegionSampleSource::RegionSampleSource(SampleSource* source, std::vector<SignalRegion> regions) {
+    this->source.reset(source);
+    this->regions = regions;
+    region = 0;
+    position = -1;
+}
+
+int RegionSampleSource::read(std::complex<double>** samples) {
+    while(region < regions.size()) {
+        if(position < regions[region].start || position >= regions[region].end) {
+            if(position >= regions[region].end) {
+                region++;
+                continue;
+            }
+            if(!source->seek(regions[region].start)) {
+                return 0;
+            }
+            position = regions[region].start;
+        }
+        int count = source->read(samples);
+        if(count <= 0) {
+            return count;
+        }
+        if(count > regions[region].end - position) {
+            count = regions[region].end - position;
+        }
+        position += count;
+        return count;
+    }
+    return 0;
+}
+
+bool RegionSampleSource::isIq() {
+    return source->isIq();
+}
+
+double RegionSampleSource::getSampleRate() {
+    return source->getSampleRate();
+}
+
+std::string RegionSampleSource::getStats() {
+    return source->getStats();
+}
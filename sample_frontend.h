@@ -0,0 +1,159 @@
+#ifndef SAMPLE_FRONTEND_H
+#define SAMPLE_FRONTEND_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+#include "sample_source.h"
+#include "sample_convert.h"
+#include "dsp.h"
+
+#define HILBERT_TAPS 191
+
+//time constant of the dc estimate, seconds
+#define LEVEL_DC_TIME 1.0
+//agc gain follows louder input with this time constant, quieter input with the slower one, seconds
+#define LEVEL_ATTACK_TIME 0.05
+#define LEVEL_DECAY_TIME 2.0
+#define LEVEL_MAX_GAIN_DB 60
+//rms the agc brings the input to(-18 dBFS)
+#define LEVEL_DEFAULT_TARGET 4096
+
+//processing stages applied on top of another source, they take ownership of it
+
+//makes analytic signal out of the real part of the input instead of (val,val) pseudo-complex samples
+//optionally shifts shiftFreq to zero and decimates the result
+class HilbertSampleSource : public SampleSource {
+public:
+    HilbertSampleSource(SampleSource* source, double sampleRate, double shiftFreq, int decimation);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    double sampleRate;
+    //odd taps 1, 3, 5... of the antisymmetric transformer
+    std::vector<double> oddTaps;
+    int delay;
+    AlignedBuffer<double> history;
+    AlignedBuffer<std::complex<double>> out;
+    size_t capacity;
+    int decimation;
+    double phase;
+    double step;
+    std::unique_ptr<DecimatingFir> decimator;
+};
+
+//moves iq spectrum up by shiftFreq
+class FrequencyShiftSampleSource : public SampleSource {
+public:
+    FrequencyShiftSampleSource(SampleSource* source, double sampleRate, double shiftFreq);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    double phase;
+    double step;
+};
+
+//converts the source to outRate with Resampler
+class ResampleSampleSource : public SampleSource {
+public:
+    ResampleSampleSource(SampleSource* source, double outRate);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    Resampler resampler;
+    double outRate;
+    AlignedBuffer<std::complex<double>> out;
+};
+
+//removes dc, brings the block rms to the target and counts clipped and near full scale samples of the input
+//without dcBlock and agc(targetRms <= 0) the samples are only counted
+class LevelSampleSource : public SampleSource {
+public:
+    LevelSampleSource(SampleSource* source, bool dcBlock, double targetRms);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    bool dcBlock;
+    double targetRms;
+    std::complex<double> dc;
+    double gain;
+    bool first;
+    //rms of the last block before the gain, dBFS
+    double levelDb;
+    long long totalSamples;
+    long long clipped;
+    long long nearFull;
+};
+
+//passes the raw samples through and keeps them in the capture ring
+class CaptureSampleSource : public SampleSource {
+public:
+    CaptureSampleSource(SampleSource* source, std::shared_ptr<CaptureRing> capture);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    std::shared_ptr<CaptureRing> capture;
+};
+
+//returns the block given with setBlock() once, to drive processing stages from other code
+class BufferSampleSource : public SampleSource {
+public:
+    BufferSampleSource(double sampleRate, bool iq);
+    void setBlock(std::complex<double>* samples, int count);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+private:
+    double sampleRate;
+    bool iq;
+    std::complex<double>* block;
+    int count;
+};
+
+//part of a recording, in samples
+struct SignalRegion {
+    long long start;
+    long long end;
+};
+
+//reads only given sorted regions of a recording, seeking over the rest
+class RegionSampleSource : public SampleSource {
+public:
+    RegionSampleSource(SampleSource* source, std::vector<SignalRegion> regions);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    std::string getStats();
+private:
+    std::unique_ptr<SampleSource> source;
+    std::vector<SignalRegion> regions;
+    size_t region;
+    long long position;
+};
+
+#endif // SAMPLE_FRONTEND_H
@@ -0,0 +1,1250 @@
+#include "sample_source.h"
+#include "sample_frontend.h"
+#include <iostream>
+#include <cstring>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <ctime>
+
+void printSourceHelp() {
+    std::cout << "--source-file <file-path>                 - select audiofile source for demodulator" << std::endl;
+    std::cout << "--source-udp <port>                       - select udp source for demodulator(compatible with gqrx). default port: 7355" << std::endl;
+    std::cout << "--source-alsa <device>                    - select alsa source for demodulator. default device: 'default'" << std::endl;
+    std::cout << "--source-rtltcp <host:port>               - receive iq from rtl_tcp server and tune it to --rtltcp-freq. default: 127.0.0.1:1234" << std::endl;
+    std::cout << "--rtltcp-freq <freq>                      - carrier frequency in Hz for rtl_tcp source" << std::endl;
+    std::cout << "--rtltcp-gain <dB/auto>                   - tuner gain of rtl_tcp source. default: auto" << std::endl;
+    std::cout << "--rtltcp-ppm <ppm>                        - frequency correction of rtl_tcp source. default: 0" << std::endl;
+    std::cout << "--source-stdin                            - read raw samples from the standard input" << std::endl;
+    std::cout << "--sample-format <s16/s24/f32>             - sample format of udp, stdin and alsa sources(file format is detected automatically). default: s16" << std::endl;
+    std::cout << "--sample-rate <rate>                      - sample rate of udp, stdin, alsa and headerless iq file sources, resampled to 48k if different. default: 48000" << std::endl;
+    std::cout << "--iq-format <s16le/f32le>                 - file, udp and stdin sources provide interleaved complex iq samples of this format instead of audio" << std::endl;
+    std::cout << "--iq-offset <freq>                        - shift iq input up by freq Hz before demodulation, stereo iq files are detected automatically. default: 0" << std::endl;
+    std::cout << "--udp-rcvbuf <bytes>                      - receive buffer size of udp source socket. default: 4194304" << std::endl;
+    std::cout << "--alsa-mmap                               - capture from alsa dma buffer directly, without copying" << std::endl;
+    std::cout << "--alsa-period <frames>                    - alsa period size. default: device default" << std::endl;
+    std::cout << "--alsa-buffer <frames>                    - alsa buffer size. default: device default" << std::endl;
+    std::cout << "--dc-block                                - remove dc offset of the input" << std::endl;
+    std::cout << "--agc <rms>                               - bring the input level to the rms(in the int16 range) with block agc. default: 4096(-18 dBFS)" << std::endl;
+    std::cout << "(--stats shows the input level and the count of clipped samples)" << std::endl;
+    std::cout << "--hilbert                                 - make analytic signal from the real input with hilbert transformer" << std::endl;
+    std::cout << "--hilbert-decim <n>                       - same as --hilbert, also shift --cent-freq to zero and decimate by n(2..10, fast demodulator engine only)" << std::endl;
+}
+
+int parseSourceArg(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive, ArgParser parseArg) {
+    std::string arg1 = std::string(argv[*position]);
+    if(arg1 == "--source-file") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        params->insert(std::pair<std::string, std::string>("demodSource", "file"));
+        params->insert(std::pair<std::string, std::string>("demodSourceFilepath", arg2));
+        return 0;
+    } else if(arg1 == "--source-udp") {
+        std::string arg2;
+        arg2 = "7355";
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+            }
+            *position = nextpos;
+        }
+        params->insert(std::pair<std::string, std::string>("demodSource", "udp"));
+        params->insert(std::pair<std::string, std::string>("demodSourceUdpPort", arg2));
+        return 0;
+    } else if(arg1 == "--source-alsa") {
+        std::string arg2;
+        arg2 = "default";
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+            }
+            *position = nextpos;
+        }
+        params->insert(std::pair<std::string, std::string>("demodSource", "alsa"));
+        params->insert(std::pair<std::string, std::string>("demodSourceAlsaDev", arg2));
+        return 0;
+    } else if(arg1 == "--source-rtltcp") {
+        std::string arg2;
+        arg2 = "127.0.0.1:" + std::to_string(RTLTCP_DEFAULT_PORT);
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>("demodSource", "rtltcp"));
+        params->insert(std::pair<std::string, std::string>("demodSourceRtltcpAddr", arg2));
+        return 0;
+    } else if(arg1 == "--rtltcp-freq" || arg1 == "--rtltcp-gain" || arg1 == "--rtltcp-ppm") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        std::string key = arg1 == "--rtltcp-freq" ? "demodSourceRtltcpFreq" : (arg1 == "--rtltcp-gain" ? "demodSourceRtltcpGain" : "demodSourceRtltcpPpm");
+        params->insert(std::pair<std::string, std::string>(key, arg2));
+        return 0;
+    } else if(arg1 == "--source-stdin") {
+        params->insert(std::pair<std::string, std::string>("demodSource", "stdin"));
+        return 0;
+    } else if(arg1 == "--iq-format" || arg1 == "--iq-offset" || arg1 == "--sample-rate") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        std::string key = arg1 == "--iq-format" ? "demodSourceIqFormat" : (arg1 == "--iq-offset" ? "demodSourceIqOffset" : "demodSourceSampleRate");
+        params->insert(std::pair<std::string, std::string>(key, arg2));
+        return 0;
+    } else if(arg1 == "--sample-format") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        params->insert(std::pair<std::string, std::string>("demodSourceSampleFormat", arg2));
+        return 0;
+    } else if(arg1 == "--alsa-mmap") {
+        params->insert(std::pair<std::string, std::string>("demodSourceAlsaMmap", "true"));
+        return 0;
+    } else if(arg1 == "--alsa-period" || arg1 == "--alsa-buffer" || arg1 == "--udp-rcvbuf") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        std::string key = arg1 == "--alsa-period" ? "demodSourceAlsaPeriod" : (arg1 == "--alsa-buffer" ? "demodSourceAlsaBuffer" : "demodSourceUdpRcvbuf");
+        params->insert(std::pair<std::string, std::string>(key, arg2));
+        return 0;
+    } else if(arg1 == "--dc-block") {
+        params->insert(std::pair<std::string, std::string>("demodSourceDcBlock", "true"));
+        return 0;
+    } else if(arg1 == "--agc") {
+        std::string arg2;
+        arg2 = std::to_string(LEVEL_DEFAULT_TARGET);
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>("demodSourceAgc", arg2));
+        return 0;
+    } else if(arg1 == "--hilbert") {
+        params->insert(std::pair<std::string, std::string>("demodSourceHilbert", "true"));
+        return 0;
+    } else if(arg1 == "--hilbert-decim") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        params->insert(std::pair<std::string, std::string>("demodSourceHilbert", "true"));
+        params->insert(std::pair<std::string, std::string>("demodSourceHilbertDecim", arg2));
+        return 0;
+    } else {
+        return 2;
+    }
+}
+
+FileSampleSource::FileSampleSource() {
+    file = AF_NULL_FILEHANDLE;
+    format = SAMPLE_FORMAT_S16;
+    iq = false;
+    sampleRate = DEMOD_SAMPLE_RATE;
+    buf.resize(BUFSIZE * 8);
+    cbuf.resize(BUFSIZE);
+}
+
+FileSampleSource::~FileSampleSource() {
+    if(file != AF_NULL_FILEHANDLE) {
+        afCloseFile(file);
+    }
+}
+
+bool FileSampleSource::open(std::string filePath, bool rawIq, SampleFormat iqFormat, double rawRate) {
+    AFfilesetup setup = AF_NULL_FILESETUP;
+    if(rawIq) {
+        setup = afNewFileSetup();
+        afInitFileFormat(setup, AF_FILE_RAWDATA);
+        afInitChannels(setup, AF_DEFAULT_TRACK, 2);
+        afInitRate(setup, AF_DEFAULT_TRACK, rawRate);
+        if(iqFormat == SAMPLE_FORMAT_F32) {
+            afInitSampleFormat(setup, AF_DEFAULT_TRACK, AF_SAMPFMT_FLOAT, 32);
+        } else {
+            afInitSampleFormat(setup, AF_DEFAULT_TRACK, AF_SAMPFMT_TWOSCOMP, 16);
+        }
+        afInitByteOrder(setup, AF_DEFAULT_TRACK, AF_BYTEORDER_LITTLEENDIAN);
+    }
+    file = afOpenFile(filePath.c_str(), "r", setup);
+    if(setup != AF_NULL_FILESETUP) {
+        afFreeFileSetup(setup);
+    }
+    if(file == AF_NULL_FILEHANDLE) {
+        std::cout << "Failed to open file!" << std::endl;
+        return false;
+    }
+    int channels = afGetChannels(file, AF_DEFAULT_TRACK);
+    sampleRate = afGetRate(file, AF_DEFAULT_TRACK);
+    if((channels != 1 and channels != 2) or sampleRate <= 0) {
+        std::cout << "Wrong file format! It should be 1 channel audio or 2 channel iq." << std::endl;
+        return false;
+    }
+    iq = channels == 2;
+    //read samples in the native precision, convertRealToComplex() scales them
+    int sampleFormat, sampleWidth;
+    afGetSampleFormat(file, AF_DEFAULT_TRACK, &sampleFormat, &sampleWidth);
+    if(sampleFormat == AF_SAMPFMT_FLOAT || sampleFormat == AF_SAMPFMT_DOUBLE) {
+        format = SAMPLE_FORMAT_F32;
+        afSetVirtualSampleFormat(file, AF_DEFAULT_TRACK, AF_SAMPFMT_FLOAT, 32);
+    } else if(sampleWidth > 16) {
+        format = SAMPLE_FORMAT_S24;
+        afSetVirtualSampleFormat(file, AF_DEFAULT_TRACK, AF_SAMPFMT_TWOSCOMP, 24);
+    } else {
+        format = SAMPLE_FORMAT_S16;
+        afSetVirtualSampleFormat(file, AF_DEFAULT_TRACK, AF_SAMPFMT_TWOSCOMP, 16);
+    }
+    afSetVirtualByteOrder(file, AF_DEFAULT_TRACK, AF_BYTEORDER_LITTLEENDIAN);
+    return true;
+}
+
+int FileSampleSource::read(std::complex<double>** samples) {
+    AFframecount framesRead = afReadFrames(file, AF_DEFAULT_TRACK, buf.data(), BUFSIZE);
+    if(framesRead <= 0) {
+        return 0;
+    }
+    if(iq) {
+        convertIqToComplex(buf.data(), format, cbuf.data(), framesRead);
+    } else {
+        convertRealToComplex(buf.data(), format, cbuf.data(), framesRead);
+    }
+    *samples = cbuf.data();
+    return framesRead;
+}
+
+bool FileSampleSource::isIq() {
+    return iq;
+}
+
+double FileSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+long long FileSampleSource::getLength() {
+    return afGetFrameCount(file, AF_DEFAULT_TRACK);
+}
+
+bool FileSampleSource::seek(long long sample) {
+    return afSeekFrame(file, AF_DEFAULT_TRACK, sample) == sample;
+}
+
+MappedFileSampleSource::MappedFileSampleSource() {
+    fd = -1;
+    map = NULL;
+    mapSize = 0;
+    dataOffset = 0;
+    dataEnd = 0;
+    position = 0;
+    releasedUntil = 0;
+    format = SAMPLE_FORMAT_S16;
+    iq = false;
+    sampleRate = DEMOD_SAMPLE_RATE;
+    cbuf.resize(BUFSIZE);
+}
+
+MappedFileSampleSource::~MappedFileSampleSource() {
+    if(map != NULL) {
+        munmap(map, mapSize);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+static uint16_t readLe16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool MappedFileSampleSource::parseWavHeader() {
+    if(mapSize < 12 || memcmp(map, "RIFF", 4) != 0 || memcmp(map + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool fmtFound = false;
+    size_t pos = 12;
+    while(pos + 8 <= mapSize) {
+        uint32_t chunkSize = readLe32(map + pos + 4);
+        const uint8_t* chunk = map + pos + 8;
+        if(memcmp(map + pos, "fmt ", 4) == 0) {
+            if(chunkSize < 16 || pos + 8 + chunkSize > mapSize) {
+                return false;
+            }
+            int tag = readLe16(chunk);
+            int channels = readLe16(chunk + 2);
+            sampleRate = readLe32(chunk + 4);
+            int bits = readLe16(chunk + 14);
+            //WAVE_FORMAT_EXTENSIBLE, tag is in the first bytes of the subformat guid
+            if(tag == 0xFFFE && chunkSize >= 40) {
+                tag = readLe16(chunk + 24);
+            }
+            if(tag == 1 && bits == 16) {
+                format = SAMPLE_FORMAT_S16;
+            } else if(tag == 3 && bits == 32) {
+                format = SAMPLE_FORMAT_F32;
+            } else {
+                //packed 24 bit, 8 bit, double and compressed formats are left to libaudiofile
+                return false;
+            }
+            if((channels != 1 && channels != 2) || sampleRate <= 0) {
+                return false;
+            }
+            iq = channels == 2;
+            fmtFound = true;
+        } else if(memcmp(map + pos, "data", 4) == 0) {
+            if(!fmtFound) {
+                return false;
+            }
+            dataOffset = pos + 8;
+            //streaming writers leave the size unset, the data lasts till the end of file then
+            dataEnd = (chunkSize == 0 || chunkSize == 0xFFFFFFFF || dataOffset + chunkSize > mapSize) ? mapSize : dataOffset + chunkSize;
+            return true;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+bool MappedFileSampleSource::open(std::string filePath, bool rawIq, SampleFormat iqFormat, double rawRate) {
+    fd = ::open(filePath.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return false;
+    }
+    mapSize = st.st_size;
+    void* p = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED) {
+        return false;
+    }
+    map = (uint8_t*)p;
+    if(rawIq) {
+        format = iqFormat;
+        iq = true;
+        sampleRate = rawRate;
+        dataOffset = 0;
+        dataEnd = mapSize;
+    } else if(!parseWavHeader()) {
+        return false;
+    }
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+    position = dataOffset;
+    releasedUntil = 0;
+    return true;
+}
+
+int MappedFileSampleSource::read(std::complex<double>** samples) {
+    int frameSize = sampleFormatSize(format) * (iq ? 2 : 1);
+    size_t frames = (dataEnd - position) / frameSize;
+    if(frames == 0) {
+        return 0;
+    }
+    int count = frames < BUFSIZE ? frames : BUFSIZE;
+    if(iq) {
+        convertIqToComplex(map + position, format, cbuf.data(), count);
+    } else {
+        convertRealToComplex(map + position, format, cbuf.data(), count);
+    }
+    position += count * frameSize;
+    //consumed pages are not needed anymore, keep them from pushing out the rest of the page cache
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    if(position - releasedUntil >= MAPPED_FILE_RELEASE_SIZE) {
+        size_t until = position / pageSize * pageSize;
+        madvise(map + releasedUntil, until - releasedUntil, MADV_DONTNEED);
+        releasedUntil = until;
+    }
+    *samples = cbuf.data();
+    return count;
+}
+
+bool MappedFileSampleSource::isIq() {
+    return iq;
+}
+
+double MappedFileSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+long long MappedFileSampleSource::getLength() {
+    return (dataEnd - dataOffset) / (sampleFormatSize(format) * (iq ? 2 : 1));
+}
+
+bool MappedFileSampleSource::seek(long long sample) {
+    if(sample < 0 || sample > getLength()) {
+        return false;
+    }
+    position = dataOffset + sample * sampleFormatSize(format) * (iq ? 2 : 1);
+    releasedUntil = position / sysconf(_SC_PAGESIZE) * sysconf(_SC_PAGESIZE);
+    return true;
+}
+
+UdpSampleSource::UdpSampleSource() {
+    clisockfd = -1;
+    format = SAMPLE_FORMAT_S16;
+    iq = false;
+    sampleRate = DEMOD_SAMPLE_RATE;
+    sampleSize = 2;
+    rcvbuf = 0;
+    batchCount = 0;
+    batchPos = 0;
+    pendingZeros = 0;
+    started = false;
+    anchorTime = 0;
+    streamSamples = 0;
+    baseline = 0;
+    kernelDrops = 0;
+    gaps = 0;
+    filledSamples = 0;
+    restarts = 0;
+    maxBatch = 0;
+    cbuf.resize(BUFSIZE);
+}
+
+UdpSampleSource::~UdpSampleSource() {
+    if(clisockfd >= 0) {
+        close(clisockfd);
+    }
+}
+
+bool UdpSampleSource::open(int port, SampleFormat format, bool iq, double sampleRate, int rcvbuf) {
+    this->format = format;
+    this->iq = iq;
+    this->sampleRate = sampleRate;
+    sampleSize = sampleFormatSize(format) * (iq ? 2 : 1);
+    if ((clisockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
+        std::cout << "Socket creation failed!" << std::endl;
+        return false;
+    }
+    //bursts of the sender are kept by the kernel until the next batch; the size is limited by net.core.rmem_max
+    setsockopt(clisockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    socklen_t optlen = sizeof(this->rcvbuf);
+    getsockopt(clisockfd, SOL_SOCKET, SO_RCVBUF, &this->rcvbuf, &optlen);
+    //datagrams come with the count of ones dropped by the socket and the kernel arrival time
+    int one = 1;
+    setsockopt(clisockfd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+    setsockopt(clisockfd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    // Filling server information
+    sockaddr_in serveraddr;
+    memset(&serveraddr, 0, sizeof(serveraddr));
+    serveraddr.sin_family = AF_INET;
+    serveraddr.sin_port = htons(port);
+    serveraddr.sin_addr.s_addr=INADDR_ANY;
+    if (bind(clisockfd, (const struct sockaddr *)&serveraddr, sizeof(serveraddr)) < 0) {
+            std::cout << "Binding to port failed!" << std::endl;
+            return false;
+    }
+    buf.resize(UDP_BATCH * BUFSIZE * sampleSize);
+    size_t controlSize = CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(timespec));
+    control.resize(UDP_BATCH * controlSize);
+    msgs.resize(UDP_BATCH);
+    iovs.resize(UDP_BATCH);
+    gapBefore.resize(UDP_BATCH);
+    for(int i = 0; i < UDP_BATCH; i++) {
+        iovs[i].iov_base = buf.data() + i * BUFSIZE * sampleSize;
+        iovs[i].iov_len = BUFSIZE * sampleSize;
+        memset(&msgs[i], 0, sizeof(mmsghdr));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = control.data() + i * controlSize;
+    }
+    return true;
+}
+
+bool UdpSampleSource::receiveBatch() {
+    size_t controlSize = control.size() / UDP_BATCH;
+    for(int i = 0; i < UDP_BATCH; i++) {
+        msgs[i].msg_hdr.msg_controllen = controlSize;
+    }
+    //waits for the first datagram, then takes all already queued ones
+    int count = recvmmsg(clisockfd, msgs.data(), UDP_BATCH, MSG_WAITFORONE, nullptr);
+    if(count <= 0) {
+        return false;
+    }
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    batchCount = count;
+    batchPos = 0;
+    if(count > maxBatch) {
+        maxBatch = count;
+    }
+    for(int i = 0; i < count; i++) {
+        double time = now.tv_sec + now.tv_nsec * 1e-9;
+        for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+            if(cmsg->cmsg_level != SOL_SOCKET) {
+                continue;
+            }
+            if(cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                kernelDrops = drops;
+            } else if(cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                time = ts.tv_sec + ts.tv_nsec * 1e-9;
+            }
+        }
+        gapBefore[i] = checkArrival(time, msgs[i].msg_len / sampleSize);
+    }
+    return true;
+}
+
+//returns count of samples missing before the datagram of count samples arrived at time
+long long UdpSampleSource::checkArrival(double time, int count) {
+    if(!started) {
+        started = true;
+        anchorTime = time - count / sampleRate;
+        streamSamples = count;
+        baseline = 0;
+        return 0;
+    }
+    //how much later than expected the datagram is, in samples
+    double late = (time - anchorTime) * sampleRate - (streamSamples + count);
+    long long missing = 0;
+    if(late < baseline) {
+        baseline = late;
+    } else if(late - baseline >= UDP_GAP_MIN_SECONDS * sampleRate) {
+        if(late - baseline > UDP_GAP_MAX_SECONDS * sampleRate) {
+            restarts++;
+            anchorTime = time - count / sampleRate;
+            streamSamples = count;
+            baseline = 0;
+            return 0;
+        }
+        missing = (long long)(late - baseline);
+        gaps++;
+        filledSamples += missing;
+        streamSamples += missing;
+    } else {
+        baseline += (late - baseline) * UDP_DRIFT_ALPHA;
+    }
+    streamSamples += count;
+    return missing;
+}
+
+int UdpSampleSource::read(std::complex<double>** samples) {
+    while(true) {
+        if(pendingZeros > 0) {
+            int count = pendingZeros > BUFSIZE ? BUFSIZE : pendingZeros;
+            std::fill(cbuf.data(), cbuf.data() + count, std::complex<double>(0, 0));
+            pendingZeros -= count;
+            *samples = cbuf.data();
+            return count;
+        }
+        if(batchPos >= batchCount && !receiveBatch()) {
+            return 0;
+        }
+        if(gapBefore[batchPos] > 0) {
+            pendingZeros = gapBefore[batchPos];
+            gapBefore[batchPos] = 0;
+            continue;
+        }
+        const uint8_t* data = (const uint8_t*)iovs[batchPos].iov_base;
+        int received = msgs[batchPos].msg_len / sampleSize;
+        batchPos++;
+        if(received <= 0) {
+            continue;
+        }
+        if(iq) {
+            convertIqToComplex(data, format, cbuf.data(), received);
+        } else {
+            convertRealToComplex(data, format, cbuf.data(), received);
+        }
+        *samples = cbuf.data();
+        return received;
+    }
+}
+
+bool UdpSampleSource::isIq() {
+    return iq;
+}
+
+double UdpSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+std::string UdpSampleSource::getStats() {
+    std::ostringstream os;
+    os << " udp drops = " << kernelDrops << " gaps = " << gaps << " (" << filledSamples / sampleRate << " s filled) restarts = " << restarts << " batch max = " << maxBatch << " rcvbuf = " << rcvbuf;
+    return os.str();
+}
+
+StdinSampleSource::StdinSampleSource() {
+    format = SAMPLE_FORMAT_S16;
+    iq = false;
+    sampleRate = DEMOD_SAMPLE_RATE;
+    buf.resize(BUFSIZE * 8);
+    cbuf.resize(BUFSIZE);
+}
+
+bool StdinSampleSource::open(SampleFormat format, bool iq, double sampleRate) {
+    this->format = format;
+    this->iq = iq;
+    this->sampleRate = sampleRate;
+    return true;
+}
+
+int StdinSampleSource::read(std::complex<double>** samples) {
+    int sampleSize = sampleFormatSize(format) * (iq ? 2 : 1);
+    //fread waits for the whole block unless the pipe is closed
+    int received = fread(buf.data(), sampleSize, BUFSIZE, stdin);
+    if(received <= 0) {
+        return 0;
+    }
+    if(iq) {
+        convertIqToComplex(buf.data(), format, cbuf.data(), received);
+    } else {
+        convertRealToComplex(buf.data(), format, cbuf.data(), received);
+    }
+    *samples = cbuf.data();
+    return received;
+}
+
+bool StdinSampleSource::isIq() {
+    return iq;
+}
+
+double StdinSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+RtlTcpSampleSource::RtlTcpSampleSource() {
+    sockfd = -1;
+    sampleRate = RTLTCP_DEFAULT_RATE;
+    tunerType = 0;
+    gainCount = 0;
+    buf.resize(RTLTCP_BLOCK * 2);
+    cbuf.resize(RTLTCP_BLOCK);
+}
+
+RtlTcpSampleSource::~RtlTcpSampleSource() {
+    if(sockfd >= 0) {
+        close(sockfd);
+    }
+}
+
+bool RtlTcpSampleSource::open(std::string host, int port, unsigned int tuneFreq, unsigned int sampleRate, int gain, int ppm) {
+    this->sampleRate = sampleRate;
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res;
+    if(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        std::cout << "Can't resolve rtl_tcp host!" << std::endl;
+        return false;
+    }
+    for(addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+        sockfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(sockfd < 0) {
+            continue;
+        }
+        if(connect(sockfd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(sockfd);
+        sockfd = -1;
+    }
+    freeaddrinfo(res);
+    if(sockfd < 0) {
+        std::cout << "Connection to rtl_tcp server failed!" << std::endl;
+        return false;
+    }
+    //server greets with "RTL0", tuner type and count of tuner gains, big endian
+    uint8_t header[12];
+    if(recv(sockfd, header, sizeof(header), MSG_WAITALL) != sizeof(header) || memcmp(header, "RTL0", 4) != 0) {
+        std::cout << "Wrong rtl_tcp server header!" << std::endl;
+        return false;
+    }
+    memcpy(&tunerType, header + 4, 4);
+    memcpy(&gainCount, header + 8, 4);
+    tunerType = ntohl(tunerType);
+    gainCount = ntohl(gainCount);
+    //commands: sample rate, frequency correction, gain mode and gain, then frequency
+    if(!sendCommand(0x02, sampleRate) || !sendCommand(0x05, (uint32_t)ppm) || !sendCommand(0x03, gain >= 0 ? 1 : 0) ||
+       (gain >= 0 && !sendCommand(0x04, gain)) || !sendCommand(0x01, tuneFreq)) {
+        std::cout << "Sending commands to rtl_tcp server failed!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RtlTcpSampleSource::sendCommand(uint8_t command, uint32_t param) {
+    uint8_t packet[5];
+    packet[0] = command;
+    param = htonl(param);
+    memcpy(packet + 1, &param, 4);
+    return send(sockfd, packet, sizeof(packet), 0) == sizeof(packet);
+}
+
+int RtlTcpSampleSource::read(std::complex<double>** samples) {
+    //whole pairs only, the stream can't get out of i/q alignment
+    int received = recv(sockfd, buf.data(), RTLTCP_BLOCK * 2, MSG_WAITALL);
+    if(received < 2) {
+        return 0;
+    }
+    convertIqU8ToComplex(buf.data(), cbuf.data(), received / 2);
+    *samples = cbuf.data();
+    return received / 2;
+}
+
+bool RtlTcpSampleSource::isIq() {
+    return true;
+}
+
+double RtlTcpSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+std::string RtlTcpSampleSource::getStats() {
+    static const char* tuners[] = {"unknown", "E4000", "FC0012", "FC0013", "FC2580", "R820T", "R828D"};
+    std::ostringstream os;
+    os << " rtltcp tuner = " << tuners[tunerType < 7 ? tunerType : 0] << " gains = " << gainCount;
+    return os.str();
+}
+
+AlsaSampleSource::AlsaSampleSource() {
+    capture_handle = NULL;
+    format = SAMPLE_FORMAT_S16;
+    sampleRate = DEMOD_SAMPLE_RATE;
+    frameSize = 2;
+    mmap = false;
+    periodSize = 0;
+    bufferSize = 0;
+    pendingRead = 0;
+    running = false;
+    stopped = true;
+    xruns = 0;
+    suspends = 0;
+    droppedFrames = 0;
+    highWater = 0;
+    buf.resize(BUFSIZE * 4);
+    cbuf.resize(BUFSIZE);
+}
+
+AlsaSampleSource::~AlsaSampleSource() {
+    //readi returns within a period, then the thread sees the flag
+    running = false;
+    if(thread.joinable()) {
+        thread.join();
+    }
+    if(capture_handle != NULL) {
+        snd_pcm_close (capture_handle);
+    }
+}
+
+bool AlsaSampleSource::open(std::string alsaDev, SampleFormat format, unsigned int rate, bool mmap, snd_pcm_uframes_t periodSize, snd_pcm_uframes_t bufferSize) {
+    int err;
+    snd_pcm_hw_params_t *hw_params;
+    this->format = format;
+    this->mmap = mmap;
+    snd_pcm_format_t pcmFormat = format == SAMPLE_FORMAT_F32 ? SND_PCM_FORMAT_FLOAT_LE : (format == SAMPLE_FORMAT_S24 ? SND_PCM_FORMAT_S24_LE : SND_PCM_FORMAT_S16_LE);
+    if ((err = snd_pcm_open (&capture_handle, alsaDev.c_str(), SND_PCM_STREAM_CAPTURE, 0)) < 0) {
+        fprintf (stderr, "cannot open audio device %s (%s)\n", alsaDev.c_str(), snd_strerror (err));
+        capture_handle = NULL;
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_malloc (&hw_params)) < 0) {
+        fprintf (stderr, "cannot allocate hardware parameter structure (%s)\n", snd_strerror (err));
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_any (capture_handle, hw_params)) < 0) {
+        fprintf (stderr, "cannot initialize hardware parameter structure (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_set_access (capture_handle, hw_params, mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+        fprintf (stderr, "cannot set access type (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_set_format (capture_handle, hw_params, pcmFormat)) < 0) {
+        fprintf (stderr, "cannot set sample format (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_set_rate_near (capture_handle, hw_params, &rate, 0)) < 0) {
+        fprintf (stderr, "cannot set sample rate (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if ((err = snd_pcm_hw_params_set_channels (capture_handle, hw_params, 1)) < 0) {
+        fprintf (stderr, "cannot set channel count (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if (periodSize > 0 && (err = snd_pcm_hw_params_set_period_size_near (capture_handle, hw_params, &periodSize, 0)) < 0) {
+        fprintf (stderr, "cannot set period size (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if (bufferSize > 0 && (err = snd_pcm_hw_params_set_buffer_size_near (capture_handle, hw_params, &bufferSize)) < 0) {
+        fprintf (stderr, "cannot set buffer size (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    if ((err = snd_pcm_hw_params (capture_handle, hw_params)) < 0) {
+        fprintf (stderr, "cannot set parameters (%s)\n", snd_strerror (err));
+        snd_pcm_hw_params_free (hw_params);
+        return false;
+    }
+    snd_pcm_hw_params_get_period_size (hw_params, &this->periodSize, 0);
+    snd_pcm_hw_params_get_buffer_size (hw_params, &this->bufferSize);
+    snd_pcm_hw_params_free (hw_params);
+    //device may have chosen another rate, it is resampled later
+    sampleRate = rate;
+    if ((err = snd_pcm_prepare (capture_handle)) < 0) {
+        fprintf (stderr, "cannot prepare audio interface for use (%s)\n", snd_strerror (err));
+        return false;
+    }
+    frameSize = sampleFormatSize(format);
+    if(mmap) {
+        sampleRing.reset(new SpscRing<std::complex<double>>((size_t)(ALSA_RING_SECONDS * sampleRate)));
+    } else {
+        ring.reset(new SpscRing<uint8_t>((size_t)(ALSA_RING_SECONDS * sampleRate) * frameSize));
+    }
+    running = true;
+    stopped = false;
+    thread = std::thread(mmap ? &AlsaSampleSource::captureMmap : &AlsaSampleSource::capture, this);
+    return true;
+}
+
+bool AlsaSampleSource::recover(int err) {
+    if(err == -EPIPE) {
+        xruns++;
+    } else if(err == -ESTRPIPE) {
+        suspends++;
+    }
+    if ((err = snd_pcm_recover (capture_handle, err, 1)) < 0) {
+        fprintf (stderr, "cannot recover audio interface (%s)\n", snd_strerror (err));
+        return false;
+    }
+    //mmap capture is not started by reading
+    if (mmap && (err = snd_pcm_start (capture_handle)) < 0) {
+        fprintf (stderr, "cannot restart audio interface (%s)\n", snd_strerror (err));
+        return false;
+    }
+    return true;
+}
+
+size_t AlsaSampleSource::getFill() {
+    return mmap ? sampleRing->size() : ring->size() / frameSize;
+}
+
+//real-time priority needs privileges, the thread keeps the normal one otherwise
+static void setCaptureThreadPriority() {
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+void AlsaSampleSource::capture() {
+    setCaptureThreadPriority();
+    while(running) {
+        uint8_t* span;
+        snd_pcm_uframes_t frames = ring->getWriteSpan(&span) / frameSize;
+        bool drop = frames == 0;
+        if(drop) {
+            //the reader is too slow, keep the device running and lose the newest samples
+            span = buf.data();
+            frames = BUFSIZE;
+        }
+        if(frames > BUFSIZE) {
+            frames = BUFSIZE;
+        }
+        snd_pcm_sframes_t framesRead = snd_pcm_readi (capture_handle, span, frames);
+        if(framesRead < 0) {
+            if(!recover(framesRead)) {
+                break;
+            }
+            continue;
+        }
+        if(drop) {
+            droppedFrames += framesRead;
+            continue;
+        }
+        ring->commitWrite(framesRead * frameSize);
+        size_t fill = getFill();
+        if(fill > highWater) {
+            highWater = fill;
+        }
+    }
+    stopped = true;
+}
+
+void AlsaSampleSource::captureMmap() {
+    setCaptureThreadPriority();
+    int err;
+    if ((err = snd_pcm_start (capture_handle)) < 0) {
+        fprintf (stderr, "cannot start audio interface (%s)\n", snd_strerror (err));
+        stopped = true;
+        return;
+    }
+    while(running) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update (capture_handle);
+        if(avail < 0) {
+            if(!recover(avail)) {
+                break;
+            }
+            continue;
+        }
+        if((snd_pcm_uframes_t)avail < periodSize) {
+            if((err = snd_pcm_wait (capture_handle, ALSA_WAIT_TIMEOUT_MS)) < 0 && !recover(err)) {
+                break;
+            }
+            continue;
+        }
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = avail;
+        if((err = snd_pcm_mmap_begin (capture_handle, &areas, &offset, &frames)) < 0) {
+            if(!recover(err)) {
+                break;
+            }
+            continue;
+        }
+        const uint8_t* dma = (const uint8_t*)areas[0].addr + areas[0].first / 8 + offset * (areas[0].step / 8);
+        std::complex<double>* span;
+        size_t free = sampleRing->getWriteSpan(&span);
+        if(free == 0) {
+            //the reader is too slow, release the area unread to keep the device running
+            droppedFrames += frames;
+        } else {
+            if(frames > free) {
+                frames = free;
+            }
+            convertRealToComplex(dma, format, span, frames);
+            sampleRing->commitWrite(frames);
+            size_t fill = getFill();
+            if(fill > highWater) {
+                highWater = fill;
+            }
+        }
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit (capture_handle, offset, frames);
+        if(committed < 0 || (snd_pcm_uframes_t)committed != frames) {
+            if(!recover(committed < 0 ? committed : -EPIPE)) {
+                break;
+            }
+        }
+    }
+    stopped = true;
+}
+
+int AlsaSampleSource::read(std::complex<double>** samples) {
+    if(mmap) {
+        sampleRing->commitRead(pendingRead);
+        pendingRead = 0;
+    }
+    uint8_t* span = nullptr;
+    std::complex<double>* sampleSpan = nullptr;
+    size_t frames;
+    while(true) {
+        //everything written before the thread stopped is visible after the flag
+        bool done = stopped;
+        frames = mmap ? sampleRing->getReadSpan(&sampleSpan) : ring->getReadSpan(&span) / frameSize;
+        if(frames > 0) {
+            break;
+        }
+        if(done) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(ALSA_RING_POLL_US));
+    }
+    int framesRead = frames > BUFSIZE ? BUFSIZE : frames;
+    if(mmap) {
+        pendingRead = framesRead;
+        *samples = sampleSpan;
+        return framesRead;
+    }
+    convertRealToComplex(span, format, cbuf.data(), framesRead);
+    ring->commitRead(framesRead * frameSize);
+    *samples = cbuf.data();
+    return framesRead;
+}
+
+double AlsaSampleSource::getSampleRate() {
+    return sampleRate;
+}
+
+std::string AlsaSampleSource::getStats() {
+    std::ostringstream os;
+    size_t capacity = mmap ? sampleRing->getCapacity() : ring->getCapacity() / frameSize;
+    os << " alsa" << (mmap ? " mmap" : "") << " period = " << periodSize << " buffer = " << bufferSize << " xruns = " << xruns << " suspends = " << suspends << " dropped = " << droppedFrames << " ring max = " << highWater * 100 / capacity << "%";
+    return os.str();
+}
+
+static SampleSource* createRawSampleSource(std::map<std::string, std::string>& params) {
+    if(params.find("demodSource") == params.end()) {
+        std::cout << "Wrong or none demodulator source!" << std::endl;
+        return nullptr;
+    }
+    std::string demodSource = params["demodSource"];
+    SampleFormat format = SAMPLE_FORMAT_S16;
+    if(params.find("demodSourceSampleFormat") != params.end() && !parseSampleFormat(params["demodSourceSampleFormat"], &format)) {
+        std::cout << "Wrong sample format!" << std::endl;
+        return nullptr;
+    }
+    double sampleRate = DEMOD_SAMPLE_RATE;
+    if(params.find("demodSourceSampleRate") != params.end()) {
+        sampleRate = std::atof(params["demodSourceSampleRate"].c_str());
+        if(sampleRate < DEMOD_MIN_SOURCE_RATE) {
+            std::cout << "Wrong sample rate!" << std::endl;
+            return nullptr;
+        }
+    }
+    bool iq = params.find("demodSourceIqFormat") != params.end();
+    if(iq && !parseIqFormat(params["demodSourceIqFormat"], &format)) {
+        std::cout << "Wrong iq format!" << std::endl;
+        return nullptr;
+    }
+    if(demodSource == "file") {
+        if(params.find("demodSourceFilepath") == params.end()) {
+            std::cout << "File path not specified!" << std::endl;
+            return nullptr;
+        }
+        MappedFileSampleSource* mappedSource = new MappedFileSampleSource();
+        if(mappedSource->open(params["demodSourceFilepath"], iq, format, sampleRate)) {
+            return mappedSource;
+        }
+        delete mappedSource;
+        FileSampleSource* source = new FileSampleSource();
+        if(!source->open(params["demodSourceFilepath"], iq, format, sampleRate)) {
+            delete source;
+            return nullptr;
+        }
+        return source;
+    } else if(demodSource == "udp") {
+        if(params.find("demodSourceUdpPort") == params.end()) {
+            std::cout << "Udp port not specified!" << std::endl;
+            return nullptr;
+        }
+        int rcvbuf = UDP_DEFAULT_RCVBUF;
+        if(params.find("demodSourceUdpRcvbuf") != params.end()) {
+            rcvbuf = std::atoi(params["demodSourceUdpRcvbuf"].c_str());
+            if(rcvbuf <= 0) {
+                std::cout << "Wrong udp receive buffer size!" << std::endl;
+                return nullptr;
+            }
+        }
+        UdpSampleSource* source = new UdpSampleSource();
+        if(!source->open(std::stoi(params["demodSourceUdpPort"]), format, iq, sampleRate, rcvbuf)) {
+            delete source;
+            return nullptr;
+        }
+        return source;
+    } else if(demodSource == "stdin") {
+        StdinSampleSource* source = new StdinSampleSource();
+        if(!source->open(format, iq, sampleRate)) {
+            delete source;
+            return nullptr;
+        }
+        return source;
+    } else if(demodSource == "rtltcp") {
+        if(params.find("demodSourceRtltcpFreq") == params.end()) {
+            std::cout << "Rtl_tcp frequency not specified!" << std::endl;
+            return nullptr;
+        }
+        std::string host = params["demodSourceRtltcpAddr"];
+        int port = RTLTCP_DEFAULT_PORT;
+        size_t colon = host.rfind(':');
+        if(colon != std::string::npos) {
+            port = std::atoi(host.substr(colon + 1).c_str());
+            host = host.substr(0, colon);
+        }
+        if(params.find("demodSourceSampleRate") == params.end()) {
+            sampleRate = RTLTCP_DEFAULT_RATE;
+        }
+        int gain = -1;
+        if(params.find("demodSourceRtltcpGain") != params.end() && params["demodSourceRtltcpGain"] != "auto") {
+            gain = (int)(std::atof(params["demodSourceRtltcpGain"].c_str()) * 10);
+        }
+        int ppm = params.find("demodSourceRtltcpPpm") != params.end() ? std::atoi(params["demodSourceRtltcpPpm"].c_str()) : 0;
+        double freq = std::atof(params["demodSourceRtltcpFreq"].c_str());
+        if(freq <= RTLTCP_TUNE_OFFSET || sampleRate < 2 * RTLTCP_TUNE_OFFSET + DEMOD_SAMPLE_RATE) {
+            std::cout << "Wrong rtl_tcp frequency or sample rate!" << std::endl;
+            return nullptr;
+        }
+        RtlTcpSampleSource* source = new RtlTcpSampleSource();
+        if(!source->open(host, port, (unsigned int)(freq - RTLTCP_TUNE_OFFSET), (unsigned int)sampleRate, gain, ppm)) {
+            delete source;
+            return nullptr;
+        }
+        return source;
+    } else if(demodSource == "alsa") {
+        if(params.find("demodSourceAlsaDev") == params.end()) {
+            std::cout << "Alsa device not specified!" << std::endl;
+            return nullptr;
+        }
+        if(iq) {
+            std::cout << "Iq input is not supported by alsa source!" << std::endl;
+            return nullptr;
+        }
+        bool alsaMmap = params.find("demodSourceAlsaMmap") != params.end();
+        int periodSize = params.find("demodSourceAlsaPeriod") != params.end() ? std::atoi(params["demodSourceAlsaPeriod"].c_str()) : 0;
+        int bufferSize = params.find("demodSourceAlsaBuffer") != params.end() ? std::atoi(params["demodSourceAlsaBuffer"].c_str()) : 0;
+        if(periodSize < 0 || bufferSize < 0) {
+            std::cout << "Wrong alsa period or buffer size!" << std::endl;
+            return nullptr;
+        }
+        AlsaSampleSource* source = new AlsaSampleSource();
+        if(!source->open(params["demodSourceAlsaDev"], format, (unsigned int)sampleRate, alsaMmap, periodSize, bufferSize)) {
+            delete source;
+            return nullptr;
+        }
+        return source;
+    } else {
+        std::cout << "Wrong or none demodulator source!" << std::endl;
+        return nullptr;
+    }
+}
+
+//level stage is added right after the raw source for --dc-block, --agc and --stats, so clipping is counted on the input samples
+static SampleSource* addLevelStage(SampleSource* source, std::map<std::string, std::string>& params) {
+    bool dcBlock = params.find("demodSourceDcBlock") != params.end();
+    double targetRms = params.find("demodSourceAgc") != params.end() ? std::atof(params["demodSourceAgc"].c_str()) : 0;
+    if(!dcBlock && targetRms <= 0 && params.find("demodStats") == params.end()) {
+        return source;
+    }
+    return new LevelSampleSource(source, dcBlock, targetRms);
+}
+
+SampleSource* createSampleSource(std::map<std::string, std::string>& params, std::shared_ptr<CaptureRing> capture) {
+    int hilbertDecimation = 1;
+    if(params.find("demodSourceHilbertDecim") != params.end()) {
+        hilbertDecimation = std::atoi(params["demodSourceHilbertDecim"].c_str());
+        if(hilbertDecimation < 1 || hilbertDecimation > HILBERT_MAX_DECIMATION) {
+            std::cout << "Wrong hilbert decimation!" << std::endl;
+            return nullptr;
+        }
+    }
+    if(params.find("demodSourceAgc") != params.end() && std::atof(params["demodSourceAgc"].c_str()) <= 0) {
+        std::cout << "Wrong agc target!" << std::endl;
+        return nullptr;
+    }
+    SampleSource* source = createRawSampleSource(params);
+    if(source == nullptr) {
+        return nullptr;
+    }
+    if(capture) {
+        source = new CaptureSampleSource(source, capture);
+    }
+    source = addLevelStage(source, params);
+    if(params["demodSource"] == "rtltcp") {
+        //the carrier is at RTLTCP_TUNE_OFFSET in the dongle band, moved to the demodulator band before decimation
+        double centFreq = DEMOD_DEFAULT_CENTER_FREQ;
+        if(params.find("demodCentFreq") != params.end()) {
+            centFreq = std::atoi(params["demodCentFreq"].c_str());
+        }
+        source = new FrequencyShiftSampleSource(source, source->getSampleRate(), centFreq - RTLTCP_TUNE_OFFSET);
+    }
+    if(source->getSampleRate() != DEMOD_SAMPLE_RATE) {
+        source = new ResampleSampleSource(source, DEMOD_SAMPLE_RATE);
+    }
+    if(source->isIq()) {
+        if(params.find("demodSourceHilbert") != params.end()) {
+            std::cout << "Hilbert transformer can't be used with iq input!" << std::endl;
+            delete source;
+            return nullptr;
+        }
+        //true complex samples go straight to the demodulator, only moved to the demodulator band
+        double offset = 0;
+        if(params.find("demodSourceIqOffset") != params.end()) {
+            offset = std::atof(params["demodSourceIqOffset"].c_str());
+        }
+        if(offset != 0) {
+            source = new FrequencyShiftSampleSource(source, DEMOD_SAMPLE_RATE, offset);
+        }
+    } else if(params.find("demodSourceIqOffset") != params.end()) {
+        std::cout << "Iq offset requires iq input!" << std::endl;
+        delete source;
+        return nullptr;
+    }
+    if(params.find("demodSourceHilbert") != params.end()) {
+        double centFreq = DEMOD_DEFAULT_CENTER_FREQ;
+        if(params.find("demodCentFreq") != params.end()) {
+            centFreq = std::atoi(params["demodCentFreq"].c_str());
+        }
+        source = new HilbertSampleSource(source, DEMOD_SAMPLE_RATE, centFreq, hilbertDecimation);
+    }
+    return source;
+}
+
+SampleSource* createWidebandSampleSource(std::map<std::string, std::string>& params) {
+    if(params.find("demodSourceAgc") != params.end() && std::atof(params["demodSourceAgc"].c_str()) <= 0) {
+        std::cout << "Wrong agc target!" << std::endl;
+        return nullptr;
+    }
+    SampleSource* source = createRawSampleSource(params);
+    if(source == nullptr) {
+        return nullptr;
+    }
+    if(!source->isIq()) {
+        std::cout << "Wideband mode requires iq input!" << std::endl;
+        delete source;
+        return nullptr;
+    }
+    return addLevelStage(source, params);
+}
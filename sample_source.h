@@ -0,0 +1,258 @@
+#ifndef SAMPLE_SOURCE_H
+#define SAMPLE_SOURCE_H
+
+#include <complex>
+#include <map>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <sys/socket.h>
+#include <audiofile.h>
+#include <alsa/asoundlib.h>
+#include "sample_convert.h"
+#include "spsc_ring.h"
+#include "capture_ring.h"
+
+#define BUFSIZE 2048
+#define DEMOD_SAMPLE_RATE 48000
+#define DEMOD_DEFAULT_CENTER_FREQ 2600
+#define HILBERT_MAX_DECIMATION 10
+#define DEMOD_MIN_SOURCE_RATE 8000
+#define MAPPED_FILE_RELEASE_SIZE (64 * 1024 * 1024)
+//datagrams received by one recvmmsg call
+#define UDP_BATCH 64
+#define UDP_DEFAULT_RCVBUF (4 * 1024 * 1024)
+//arrival later than the sample rate allows by this time is a gap filled with zeros
+#define UDP_GAP_MIN_SECONDS 0.1
+//longer pauses are taken as the sender restart and are not filled
+#define UDP_GAP_MAX_SECONDS 10
+//how fast the timing reference follows the sender clock drift, per datagram
+#define UDP_DRIFT_ALPHA 0.001
+#define RTLTCP_DEFAULT_PORT 1234
+#define RTLTCP_DEFAULT_RATE 240000
+//the dongle is tuned below the carrier by this, away from its dc spike
+#define RTLTCP_TUNE_OFFSET 60000
+//iq pairs received at once
+#define RTLTCP_BLOCK (BUFSIZE * 4)
+//alsa capture thread can run ahead of the demodulator by this time
+#define ALSA_RING_SECONDS 4
+//interval of checking the empty ring by the reader
+#define ALSA_RING_POLL_US 2000
+//mmap capture thread checks the stop flag at least this often
+#define ALSA_WAIT_TIMEOUT_MS 100
+
+//parseArg() of the program, used to check if the next argument is a value or another key
+typedef int (*ArgParser)(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive);
+
+//parses --source-* keys; returns 2 if the argument is not a source argument(same as parseArg)
+int parseSourceArg(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive, ArgParser parseArg);
+void printSourceHelp();
+
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+    //reads next block of samples; *samples points to the source buffer, valid until the next read() call
+    //returns count of samples, 0 or less at the end of stream
+    virtual int read(std::complex<double>** samples) = 0;
+    //true if the source produces complex iq samples instead of (val,val) pseudo-complex ones
+    virtual bool isIq() {
+        return false;
+    }
+    //rate of the produced samples; sources with other rate than DEMOD_SAMPLE_RATE are resampled by createSampleSource()
+    virtual double getSampleRate() {
+        return DEMOD_SAMPLE_RATE;
+    }
+    //recordings only: count of samples at getSampleRate(), -1 for endless sources
+    virtual long long getLength() {
+        return -1;
+    }
+    //recordings only: continue reading from the sample, state of the processing stages is not reset
+    virtual bool seek(long long sample) {
+        (void)sample;
+        return false;
+    }
+    //additional statistics for --stats line
+    virtual std::string getStats() {
+        return "";
+    }
+};
+
+class FileSampleSource : public SampleSource {
+public:
+    FileSampleSource();
+    ~FileSampleSource();
+    //opens audio file(mono audio or stereo iq) of any rate; if rawIq is set, the file is read as headerless interleaved iq of iqFormat and rawRate instead
+    bool open(std::string filePath, bool rawIq = false, SampleFormat iqFormat = SAMPLE_FORMAT_S16, double rawRate = DEMOD_SAMPLE_RATE);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+private:
+    AFfilehandle file;
+    SampleFormat format;
+    bool iq;
+    double sampleRate;
+    AlignedBuffer<uint8_t> buf;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//reads plain pcm/float wav and headerless files straight from the memory mapping, without copying the blocks
+class MappedFileSampleSource : public SampleSource {
+public:
+    MappedFileSampleSource();
+    ~MappedFileSampleSource();
+    //returns false without printing anything if the file can't be mapped or its format is not supported, FileSampleSource is used then
+    bool open(std::string filePath, bool rawIq = false, SampleFormat iqFormat = SAMPLE_FORMAT_S16, double rawRate = DEMOD_SAMPLE_RATE);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    long long getLength();
+    bool seek(long long sample);
+private:
+    bool parseWavHeader();
+    int fd;
+    uint8_t* map;
+    size_t mapSize;
+    size_t dataOffset;
+    size_t dataEnd;
+    size_t position;
+    //mapping behind position is released every MAPPED_FILE_RELEASE_SIZE bytes
+    size_t releasedUntil;
+    SampleFormat format;
+    bool iq;
+    double sampleRate;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//drains the socket with recvmmsg into a pool of UDP_BATCH datagrams
+//datagrams arriving later than the sample rate allows are preceded by zeros, so the demodulator timing doesn't slip over lost ones
+class UdpSampleSource : public SampleSource {
+public:
+    UdpSampleSource();
+    ~UdpSampleSource();
+    //rcvbuf is requested socket receive buffer size in bytes, the kernel may limit it
+    bool open(int port, SampleFormat format, bool iq = false, double sampleRate = DEMOD_SAMPLE_RATE, int rcvbuf = UDP_DEFAULT_RCVBUF);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    std::string getStats();
+private:
+    bool receiveBatch();
+    long long checkArrival(double time, int count);
+    int clisockfd;
+    SampleFormat format;
+    bool iq;
+    double sampleRate;
+    int sampleSize;
+    int rcvbuf;
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iovs;
+    std::vector<uint8_t> control;
+    //zeros to insert before each datagram of the batch
+    std::vector<long long> gapBefore;
+    int batchCount;
+    int batchPos;
+    long long pendingZeros;
+    bool started;
+    //arrival time of the stream start if the sender runs at exactly sampleRate
+    double anchorTime;
+    double streamSamples;
+    //usual lateness of datagrams, follows jitter and clock drift slowly
+    double baseline;
+    long long kernelDrops;
+    long long gaps;
+    long long filledSamples;
+    long long restarts;
+    int maxBatch;
+    AlignedBuffer<uint8_t> buf;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//reads raw samples piped to the standard input
+class StdinSampleSource : public SampleSource {
+public:
+    StdinSampleSource();
+    bool open(SampleFormat format, bool iq = false, double sampleRate = DEMOD_SAMPLE_RATE);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+private:
+    SampleFormat format;
+    bool iq;
+    double sampleRate;
+    AlignedBuffer<uint8_t> buf;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//client of rtl_tcp server: tunes the dongle and receives its unsigned 8 bit iq
+class RtlTcpSampleSource : public SampleSource {
+public:
+    RtlTcpSampleSource();
+    ~RtlTcpSampleSource();
+    //gain in tenths of dB, negative for the tuner auto gain
+    bool open(std::string host, int port, unsigned int tuneFreq, unsigned int sampleRate, int gain, int ppm);
+    int read(std::complex<double>** samples);
+    bool isIq();
+    double getSampleRate();
+    std::string getStats();
+private:
+    bool sendCommand(uint8_t command, uint32_t param);
+    int sockfd;
+    double sampleRate;
+    uint32_t tunerType;
+    uint32_t gainCount;
+    AlignedBuffer<uint8_t> buf;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//device is read by a separate capture thread into SpscRing, so slow demodulation doesn't cause overruns
+//overruns and suspends are recovered, the stream ends only on unrecoverable device errors
+//in mmap mode samples are converted from the dma areas straight into the ring and read() returns them in place
+class AlsaSampleSource : public SampleSource {
+public:
+    AlsaSampleSource();
+    ~AlsaSampleSource();
+    //rate, periodSize and bufferSize(frames, 0 for the device default) are only requested, the device may choose others
+    bool open(std::string alsaDev, SampleFormat format, unsigned int rate = DEMOD_SAMPLE_RATE, bool mmap = false, snd_pcm_uframes_t periodSize = 0, snd_pcm_uframes_t bufferSize = 0);
+    int read(std::complex<double>** samples);
+    double getSampleRate();
+    std::string getStats();
+private:
+    void capture();
+    void captureMmap();
+    bool recover(int err);
+    size_t getFill();
+    snd_pcm_t *capture_handle;
+    SampleFormat format;
+    double sampleRate;
+    int frameSize;
+    bool mmap;
+    snd_pcm_uframes_t periodSize;
+    snd_pcm_uframes_t bufferSize;
+    std::unique_ptr<SpscRing<uint8_t>> ring;
+    std::unique_ptr<SpscRing<std::complex<double>>> sampleRing;
+    //samples returned by the last read() in mmap mode, released on the next one
+    size_t pendingRead;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> stopped;
+    std::atomic<long long> xruns;
+    std::atomic<long long> suspends;
+    //frames thrown away because the ring was full
+    std::atomic<long long> droppedFrames;
+    std::atomic<size_t> highWater;
+    //capture thread reads here when the ring is full
+    AlignedBuffer<uint8_t> buf;
+    AlignedBuffer<std::complex<double>> cbuf;
+};
+
+//creates the source selected by parseSourceArg() with processing stages on top of it; prints the error and returns nullptr on failure
+//raw samples are kept in capture, if given
+SampleSource* createSampleSource(std::map<std::string, std::string>& params, std::shared_ptr<CaptureRing> capture = nullptr);
+//creates the selected iq source at its own rate, without any processing stages(input of the channelizer); prints the error and returns nullptr for real sources
+SampleSource* createWidebandSampleSource(std::map<std::string, std::string>& params);
+
+#endif // SAMPLE_SOURCE_H
@@ -0,0 +1,208 @@
+#include "segmented_demod.h"
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <inmarsatc_demodulator.h>
+#include "sample_source.h"
+#include "demod_engine.h"
+
+SymbolStitcher::SymbolStitcher(std::function<void(uint8_t*)> output) {
+    this->output = output;
+    first = true;
+    alignedSeams = 0;
+    unalignedSeams = 0;
+}
+
+void SymbolStitcher::append(const std::vector<uint8_t>& symbols, int overlapSymbols, bool afterGap) {
+    int start = 0;
+    bool invert = false;
+    if(afterGap) {
+        tail.clear();
+    } else if(!first && (int)tail.size() == SEAM_WINDOW) {
+        //find where the end of the previous segment is in this one
+        int bestMatches = -1;
+        int bestEnd = 0;
+        bool bestInverted = false;
+        int lastEnd = std::min((int)symbols.size(), overlapSymbols * 2);
+        for(int end = SEAM_WINDOW; end <= lastEnd; end++) {
+            const uint8_t* other = symbols.data() + end - SEAM_WINDOW;
+            int matches = 0;
+            for(int i = 0; i < SEAM_WINDOW; i++) {
+                matches += tail[i] == other[i];
+            }
+            //the segment may have locked with the opposite phase
+            bool inverted = SEAM_WINDOW - matches > matches;
+            if(inverted) {
+                matches = SEAM_WINDOW - matches;
+            }
+            if(matches > bestMatches) {
+                bestMatches = matches;
+                bestEnd = end;
+                bestInverted = inverted;
+            }
+        }
+        if(bestMatches >= SEAM_WINDOW * SEAM_MIN_AGREEMENT) {
+            start = bestEnd;
+            invert = bestInverted;
+            alignedSeams++;
+        } else {
+            //no signal at the seam, drop the overlap by its duration
+            start = std::min((int)symbols.size(), overlapSymbols);
+            unalignedSeams++;
+        }
+    } else if(!first) {
+        start = std::min((int)symbols.size(), overlapSymbols);
+        unalignedSeams++;
+    }
+    first = false;
+    for(int i = start; i < (int)symbols.size(); i++) {
+        uint8_t symbol = invert ? (symbols[i] ? 0 : 1) : symbols[i];
+        pending.push_back(symbol);
+        tail.push_back(symbol);
+    }
+    if((int)tail.size() > SEAM_WINDOW) {
+        tail.erase(tail.begin(), tail.end() - SEAM_WINDOW);
+    }
+    int chunks = pending.size() / DEMODULATOR_SYMBOLSPERCHUNK;
+    for(int c = 0; c < chunks; c++) {
+        output(pending.data() + c * DEMODULATOR_SYMBOLSPERCHUNK);
+    }
+    pending.erase(pending.begin(), pending.begin() + chunks * DEMODULATOR_SYMBOLSPERCHUNK);
+}
+
+int SymbolStitcher::getAlignedSeams() {
+    return alignedSeams;
+}
+
+int SymbolStitcher::getUnalignedSeams() {
+    return unalignedSeams;
+}
+
+static bool demodulateSegment(std::map<std::string, std::string> params, long long start, long long end, std::vector<uint8_t>* symbols) {
+    std::unique_ptr<SampleSource> source(createSampleSource(params));
+    std::unique_ptr<DemodEngine> demod(createDemodEngine(params));
+    if(!source || !demod || !source->seek(start)) {
+        return false;
+    }
+    long long remaining = end - start;
+    std::complex<double>* samples;
+    int samplesRead;
+    while(remaining > 0 && (samplesRead = source->read(&samples)) > 0) {
+        if(samplesRead > remaining) {
+            samplesRead = remaining;
+        }
+        std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod->demodulate(samples, samplesRead);
+        for(int d = 0; d < (int)res.size(); d++) {
+            symbols->insert(symbols->end(), res[d].bitsDemodulated, res[d].bitsDemodulated + DEMODULATOR_SYMBOLSPERCHUNK);
+        }
+        remaining -= samplesRead;
+    }
+    return true;
+}
+
+struct Segment {
+    long long start;
+    long long end;
+    bool afterGap;
+};
+
+bool runSegmentedDemod(std::map<std::string, std::string> params, int jobs, std::vector<SignalRegion> regions, std::function<void(uint8_t*)> output, SegmentedDemodStats* stats) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::unique_ptr<SampleSource> probe(createSampleSource(params));
+    if(!probe) {
+        return false;
+    }
+    long long length = probe->getLength();
+    double rate = probe->getSampleRate();
+    if(length <= 0 || !probe->seek(0)) {
+        std::cout << "Parallel demodulation requires a recording as the source!" << std::endl;
+        return false;
+    }
+    probe.reset();
+    if(regions.empty()) {
+        SignalRegion whole;
+        whole.start = 0;
+        whole.end = length;
+        regions.push_back(whole);
+    }
+    long long segmentLength = SEGMENT_SECONDS * rate;
+    long long overlap = SEGMENT_OVERLAP_SECONDS * rate;
+    std::vector<Segment> segmentList;
+    for(size_t r = 0; r < regions.size(); r++) {
+        for(long long start = regions[r].start; start < regions[r].end; start += segmentLength) {
+            Segment segment;
+            //segments inside the region start earlier to be in sync at the seam
+            segment.start = start == regions[r].start ? start : std::max(regions[r].start, start - overlap);
+            segment.end = std::min(regions[r].end, start + segmentLength);
+            segment.afterGap = start == regions[r].start && r > 0;
+            segmentList.push_back(segment);
+        }
+    }
+    int segments = segmentList.size();
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    int nextSegment = 0;
+    int stitched = 0;
+    bool failed = false;
+    std::map<int, std::vector<uint8_t>> done;
+    std::vector<std::thread> workers;
+    for(int j = 0; j < jobs; j++) {
+        workers.emplace_back([&]() {
+            while(true) {
+                int segment;
+                {
+                    //keep workers from running too far ahead of the stitching
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cond.wait(lock, [&] { return failed || nextSegment >= segments || nextSegment < stitched + jobs * 2; });
+                    if(failed || nextSegment >= segments) {
+                        return;
+                    }
+                    segment = nextSegment++;
+                }
+                std::vector<uint8_t> symbols;
+                bool ok = demodulateSegment(params, segmentList[segment].start, segmentList[segment].end, &symbols);
+                std::unique_lock<std::mutex> lock(mtx);
+                if(!ok) {
+                    failed = true;
+                }
+                done[segment].swap(symbols);
+                cond.notify_all();
+            }
+        });
+    }
+    SymbolStitcher stitcher(output);
+    int overlapSymbols = SEGMENT_OVERLAP_SECONDS * SEGMENT_SYMBOL_RATE;
+    for(int segment = 0; segment < segments; segment++) {
+        std::vector<uint8_t> symbols;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cond.wait(lock, [&] { return failed || done.find(segment) != done.end(); });
+            if(failed) {
+                break;
+            }
+            symbols.swap(done[segment]);
+            done.erase(segment);
+            stitched = segment + 1;
+            cond.notify_all();
+        }
+        stitcher.append(symbols, overlapSymbols, segmentList[segment].afterGap);
+    }
+    for(size_t j = 0; j < workers.size(); j++) {
+        workers[j].join();
+    }
+    if(failed) {
+        std::cout << "Segment demodulation failed!" << std::endl;
+        return false;
+    }
+    stats->segments = segments;
+    stats->alignedSeams = stitcher.getAlignedSeams();
+    stats->unalignedSeams = stitcher.getUnalignedSeams();
+    stats->recordingSeconds = length / rate;
+    stats->wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
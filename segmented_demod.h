@@ -0,0 +1,51 @@
+#ifndef SEGMENTED_DEMOD_H
+#define SEGMENTED_DEMOD_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "sample_frontend.h"
+
+//length of the part of the recording demodulated by one job
+#define SEGMENT_SECONDS 300
+//each segment starts this earlier, so its demodulator is in sync when the previous segment ends
+#define SEGMENT_OVERLAP_SECONDS 20
+//symbols at the end of the stitched stream searched for in the overlap of the next segment
+#define SEAM_WINDOW 1024
+#define SEAM_MIN_AGREEMENT 0.9
+#define SEGMENT_SYMBOL_RATE 1200
+
+struct SegmentedDemodStats {
+    int segments;
+    int alignedSeams;
+    int unalignedSeams;
+    double recordingSeconds;
+    double wallSeconds;
+};
+
+//joins symbol streams of overlapping segments in order and cuts them to chunks of DEMODULATOR_SYMBOLSPERCHUNK
+class SymbolStitcher {
+public:
+    SymbolStitcher(std::function<void(uint8_t*)> output);
+    //symbols of the next segment, its start overlaps the end of the previous one by overlapSymbols
+    //the first segment of the region after a gap is appended as is
+    void append(const std::vector<uint8_t>& symbols, int overlapSymbols, bool afterGap = false);
+    int getAlignedSeams();
+    int getUnalignedSeams();
+private:
+    std::function<void(uint8_t*)> output;
+    bool first;
+    //last SEAM_WINDOW symbols of the stitched stream
+    std::vector<uint8_t> tail;
+    std::vector<uint8_t> pending;
+    int alignedSeams;
+    int unalignedSeams;
+};
+
+//demodulates the recording selected in params by jobs threads in overlapping segments, each one with its own source and demodulator
+//only regions are demodulated(whole recording if empty); output gets the stitched stream in order; returns false if the source is not a seekable recording
+bool runSegmentedDemod(std::map<std::string, std::string> params, int jobs, std::vector<SignalRegion> regions, std::function<void(uint8_t*)> output, SegmentedDemodStats* stats);
+
+#endif // SEGMENTED_DEMOD_H
@@ -0,0 +1,64 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+//lock-free ring for one producer thread and one consumer thread
+//items are written and read in place through contiguous spans, so nothing is copied in or out
+template <typename T>
+class SpscRing {
+public:
+    SpscRing(size_t capacity) : items(capacity) {
+        this->capacity = capacity;
+        head = 0;
+        tail = 0;
+    }
+
+    //producer: free contiguous space at the write position, up to the end of the storage
+    size_t getWriteSpan(T** data) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t free = capacity - (h - tail.load(std::memory_order_acquire));
+        size_t offset = h % capacity;
+        *data = items.data() + offset;
+        return free < capacity - offset ? free : capacity - offset;
+    }
+
+    //producer: makes count items of the write span visible to the consumer
+    void commitWrite(size_t count) {
+        head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    //consumer: filled contiguous items at the read position, up to the end of the storage
+    size_t getReadSpan(T** data) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t filled = head.load(std::memory_order_acquire) - t;
+        size_t offset = t % capacity;
+        *data = items.data() + offset;
+        return filled < capacity - offset ? filled : capacity - offset;
+    }
+
+    //consumer: returns count items of the read span to the producer
+    void commitRead(size_t count) {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    //approximate when called from a third thread
+    size_t size() {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t getCapacity() {
+        return capacity;
+    }
+
+private:
+    std::vector<T> items;
+    size_t capacity;
+    //positions only grow, index in the storage is position % capacity
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+#endif // SPSC_RING_H
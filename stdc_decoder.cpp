@@ -5,8 +5,14 @@
 #include <map>
 #include <cstring>
 #include <array>
+#include <memory>
+#include <ctime>
+#include <cstdlib>
+#include "tagged_symbols.h"
 
 #define TOLERANCE 9
+//decoder of a tagged carrier is dropped after no symbols of it for this time, seconds
+#define CARRIER_DECODER_TIMEOUT 300
 
 void printHelp() {
     std::cout << "Help: " << std::endl;
@@ -14,7 +20,7 @@ void printHelp() {
     std::cout << "Keys: " << std::endl;
     std::cout << "--help                                    - this help" << std::endl;
     std::cout << "--verbose                                 - print all frames in hex" << std::endl;
-    std::cout << "--in-udp <port>                           - input symbols via udp(default port: 15003)" << std::endl;
+    std::cout << "--in-udp <port>                           - input symbols via udp(default port: 15003). symbols tagged with the carrier frequency(stdc_demod --discover) are decoded by separate decoder for each carrier. packed symbols(stdc_demod --packed) and soft decisions(stdc_demod --soft) are accepted too" << std::endl;
     std::cout << "--out-udp <ip> <port>                     - send decoded frames via udp(default: 127.0.0.1:15004)" << std::endl;
     std::cout << "(one source and one out parameters should be selected)" << std::endl;
 }
@@ -86,14 +92,6 @@ void printDecodedFrameVerbose(inmarsatc::decoder::Decoder::decoder_result frame)
     std::cout << std::endl << " }"  << std::endl;
 }
 
-inmarsatc::demodulator::Demodulator::demodulator_result receiveDemodDataViaUdp(int sockfd, sockaddr_in serveraddr) {
-    inmarsatc::demodulator::Demodulator::demodulator_result ret;
-    ret.meanMagnitude = 0;
-    socklen_t len_useless = sizeof(serveraddr);
-    recvfrom(sockfd, (char *)ret.bitsDemodulated, (sizeof(ret.bitsDemodulated)), MSG_WAITALL, ( struct sockaddr *) &serveraddr, &len_useless);
-    return ret;
-}
-
 //serialization
 template< typename T >
 std::array< char, sizeof(T) >  to_bytes( const T& object ) {
@@ -180,15 +178,82 @@ int main(int argc, char* argv[]) {
                 std::cout << "Binding to port failed!" << std::endl;
                 return 1;
         }
-        int received;
+        //decoders of the tagged carriers and the time of their last symbols
+        std::map<int32_t, std::unique_ptr<inmarsatc::decoder::Decoder>> carrierDecoders;
+        std::map<int32_t, time_t> carrierLastUsed;
         while(true) {
-            inmarsatc::demodulator::Demodulator::demodulator_result syms = receiveDemodDataViaUdp(clisockfd, serveraddr);
-            std::vector<inmarsatc::decoder::Decoder::decoder_result> dec_res = decoder.decode(syms.bitsDemodulated);
-            for(int i = 0; i < dec_res.size(); i++) {
-                if(isDecoderVerbose) {
-                    printDecodedFrameVerbose(dec_res[i]);
+            uint8_t datagram[SYMBOLS_MAX_DATAGRAM];
+            socklen_t len_useless = sizeof(serveraddr);
+            int received = recvfrom(clisockfd, (char *)datagram, sizeof(datagram), 0, ( struct sockaddr *) &serveraddr, &len_useless);
+            //datagram of stdc_demod --batch has several chunks one after another
+            int chunkLength;
+            for(int offset = 0; offset < received && (chunkLength = getChunkLength(datagram + offset, received - offset)) > 0; offset += chunkLength) {
+                uint8_t* chunk = datagram + offset;
+                uint8_t* symbols;
+                bool isTagged = false;
+                int32_t freq = 0;
+                //mean magnitude of the soft decisions, 0..1; -1 for hard symbols
+                double confidence = -1;
+                SymbolsHeader header;
+                SoftChunk soft;
+                uint8_t sliced[DEMODULATOR_SYMBOLSPERCHUNK];
+                TaggedSymbols tagged;
+                if(unpackHardSymbols(chunk, chunkLength, &header, sliced)) {
+                    symbols = sliced;
+                    isTagged = (header.flags & SYMBOLS_FLAG_TAGGED) != 0;
+                    freq = header.freq;
+                } else if(unpackSoftSymbols(chunk, chunkLength, &header, &soft)) {
+                    //library decoder takes only hard symbols
+                    int magnitude = 0;
+                    for(int i = 0; i < DEMODULATOR_SYMBOLSPERCHUNK; i++) {
+                        sliced[i] = soft.symbols[i] > 0 ? 1 : 0;
+                        magnitude += std::abs(soft.symbols[i]);
+                    }
+                    confidence = (double)magnitude / DEMODULATOR_SYMBOLSPERCHUNK / SOFT_SYMBOL_MAX;
+                    symbols = sliced;
+                    isTagged = (header.flags & SYMBOLS_FLAG_TAGGED) != 0;
+                    freq = header.freq;
+                } else if(chunkLength == DEMODULATOR_SYMBOLSPERCHUNK) {
+                    symbols = chunk;
+                } else {
+                    memcpy(&tagged, chunk, sizeof(tagged));
+                    symbols = tagged.symbols;
+                    isTagged = true;
+                    freq = tagged.freq;
+                }
+                std::vector<inmarsatc::decoder::Decoder::decoder_result> dec_res;
+                if(isTagged) {
+                    time_t now = time(nullptr);
+                    std::unique_ptr<inmarsatc::decoder::Decoder>& carrierDecoder = carrierDecoders[freq];
+                    if(!carrierDecoder) {
+                        carrierDecoder.reset(new inmarsatc::decoder::Decoder(TOLERANCE));
+                        //retired carriers are found only when a new one appears
+                        for(std::map<int32_t, time_t>::iterator it = carrierLastUsed.begin(); it != carrierLastUsed.end();) {
+                            if(now - it->second > CARRIER_DECODER_TIMEOUT) {
+                                carrierDecoders.erase(it->first);
+                                it = carrierLastUsed.erase(it);
+                            } else {
+                                ++it;
+                            }
+                        }
+                    }
+                    carrierLastUsed[freq] = now;
+                    dec_res = carrierDecoder->decode(symbols);
+                } else {
+                    dec_res = decoder.decode(symbols);
+                }
+                for(int i = 0; i < dec_res.size(); i++) {
+                    if(isDecoderVerbose) {
+                        if(isTagged) {
+                            std::cout << "carrier: " << std::dec << freq << " Hz" << std::endl;
+                        }
+                        if(confidence >= 0) {
+                            std::cout << "soft confidence: " << std::dec << confidence << std::endl;
+                        }
+                        printDecodedFrameVerbose(dec_res[i]);
+                    }
+                    sendDecodedFrameViaUdp(dec_res[i], sockfd, clientaddr);
                 }
-                sendDecodedFrameViaUdp(dec_res[i], sockfd, clientaddr);
             }
         }
     }
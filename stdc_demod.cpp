@@ -1,12 +1,31 @@
 #include <iostream>
 #include <inmarsatc_demodulator.h>
-#include <audiofile.h>
-#include <alsa/asoundlib.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <map>
+#include <memory>
+#include <sstream>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+#include <csignal>
+#include <cctype>
+#include "sample_source.h"
+#include "demod_engine.h"
+#include "segmented_demod.h"
+#include "prescan.h"
+#include "wideband_demod.h"
+#include "tagged_symbols.h"
+#include "symbol_sender.h"
 
-#define BUFSIZE 2048
+//--stats line of the multi-source mode is refreshed with this interval
+#define MULTI_STATS_INTERVAL_MS 500
+#define CAPTURE_DEFAULT_PREFIX "stdc_capture"
+#define CAPTURE_DEFAULT_CONTROL_PORT 15006
 
 void printHelp() {
     std::cout << "Help: " << std::endl;
@@ -17,11 +36,29 @@ void printHelp() {
     std::cout << "--hi-freq <freq>                          - set demodulator high frequency. default: 4500" << std::endl;
     std::cout << "--cent-freq <freq>                        - set demodulator initial center frequency. default: 2600" << std::endl;
     std::cout << "--stats                                   - print demodulator statistics(frequency, etc...)" << std::endl;
-    std::cout << "--source-file <file-path>                 - select audiofile source for demodulator" << std::endl;
-    std::cout << "--source-udp <port>                       - select udp source for demodulator(compatible with gqrx). default port: 7355" << std::endl;
-    std::cout << "--source-alsa <device>                    - select alsa source for demodulator. default device: 'default'" << std::endl;
+    std::cout << "--demod-engine <lib/fast/compare>         - select demodulator: inmarsatc library, in-tree single precision one or both with symbols comparison. default: lib" << std::endl;
+    std::cout << "--auto-tune <threshold>                   - find the carrier with fft at start and after sync loss and tune the demodulator to it. default threshold: 8 dB" << std::endl;
+    std::cout << "--race <n>                                - run n demodulators at frequencies spread across lo..hi on parallel threads and use the one which gets in sync first" << std::endl;
+    std::cout << "--squelch <threshold>                     - demodulate only while the level of lo..hi band is over the threshold, the last second before is demodulated too. noise is measured on the band widened to 3x the carrier(~5 kHz). default threshold: 3 dB" << std::endl;
+    std::cout << "--jobs <n>                                - demodulate the recording in overlapping segments on n threads and stitch the symbols(file source only)" << std::endl;
+    std::cout << "--channelize <n>                          - split the wideband iq input into n channels(power of 2) with a polyphase filterbank and demodulate the carriers selected with --channel" << std::endl;
+    std::cout << "--channel <freq> <port>                   - carrier at freq Hz from the center of the iq input, its symbols are sent to the --out-udp ip and this port. can be repeated" << std::endl;
+    std::cout << "--discover <threshold>                    - instead of --channel, find the carriers in the averaged spectrum of the iq input and demodulate every one while it's present. symbols are sent to --out-udp tagged with the carrier frequency. default threshold: 6 dB" << std::endl;
+    std::cout << "--carrier-timeout <seconds>               - discovered carrier is retired after it is gone for this time. default: 30" << std::endl;
+    std::cout << "(in channelize mode --jobs is the count of threads demodulating the carriers)" << std::endl;
+    std::cout << "--prescan <threshold>                     - find regions of the recording with carrier first and demodulate only them(file source only). default threshold: 8 dB" << std::endl;
+    printSourceHelp();
     std::cout << "--out-udp <ip> <port>                     - send demodulated symbols via udp to specified ip:port. default: 127.0.0.1:15003" << std::endl;
-    std::cout << "(one source and one out parameters should be selected)" << std::endl;
+    std::cout << "--packed                                  - send 8 symbols per byte with a header instead of byte per symbol(see tagged_symbols.h), stdc_decoder detects the format itself" << std::endl;
+    std::cout << "--soft <4/8>                              - send soft decisions quantized to 4 or 8 bits per symbol instead of the symbols, in versioned datagrams(see tagged_symbols.h), requires fast engine" << std::endl;
+    std::cout << "--batch <bytes>                           - put several chunks of symbols into one datagram up to this size and send the datagrams of all outs with one syscall. default: 60000" << std::endl;
+    std::cout << "--batch-delay <ms>                        - chunk waits in the --batch datagram for this time at most. default: 1000" << std::endl;
+    std::cout << "--capture <seconds>                       - keep the last seconds of the raw input in memory and write them to a wav file on SIGUSR1, --capture-control command or sync loss. default: 300" << std::endl;
+    std::cout << "--capture-file <prefix>                   - capture files are named <prefix>_<utc time>_<reason>.wav. default: stdc_capture" << std::endl;
+    std::cout << "--capture-control <port>                  - write the capture on udp datagram 'capture [reason]', for example from stdc_parser --crc-trigger. default port: 15006" << std::endl;
+    std::cout << "--cpu <n>                                 - pin the demodulation thread to cpu core n" << std::endl;
+    std::cout << "--next                                    - start the arguments of the next source: every source gets its own demodulator, thread and out. options not related to source, out and cpu are taken from the first source if not given" << std::endl;
+    std::cout << "(one source and one out parameters should be selected for every source)" << std::endl;
 }
 
 int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive) {
@@ -32,6 +69,9 @@ int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::s
     } else if(arg1 == "--stats") {
         params->insert(std::pair<std::string, std::string>("demodStats", "true"));
         return 0;
+    } else if(arg1 == "--packed") {
+        params->insert(std::pair<std::string, std::string>("demodPacked", "true"));
+        return 0;
     } else if(arg1 == "--lo-freq") {
         int nextpos = *position + 1;
         if(nextpos > argc or recursive) {
@@ -71,9 +111,25 @@ int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::s
         std::string arg2 = std::string(argv[nextpos]);
         params->insert(std::pair<std::string, std::string>("demodCentFreq", arg2));
         return 0;
-    } else if(arg1 == "--source-file") {
+    } else if(arg1 == "--channel") {
         int nextpos = *position + 1;
-        if(nextpos > argc or recursive) {
+        if(nextpos + 1 >= argc or recursive) {
+            return 1;
+        }
+        if(parseArg(argc, &nextpos, argv, params, true) != 2) {
+            return 1;
+        }
+        nextpos++;
+        if(parseArg(argc, &nextpos, argv, params, true) != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        //can be repeated, so carriers are accumulated in one param
+        (*params)["demodChannels"] += std::string(argv[nextpos - 1]) + " " + std::string(argv[nextpos]) + " ";
+        return 0;
+    } else if(arg1 == "--jobs" || arg1 == "--race" || arg1 == "--channelize" || arg1 == "--carrier-timeout" || arg1 == "--cpu" || arg1 == "--soft" || arg1 == "--batch-delay" || arg1 == "--capture-file") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
             return 1;
         }
         int parseRes = parseArg(argc, &nextpos, argv, params, true);
@@ -82,36 +138,73 @@ int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::s
         }
         *position = nextpos;
         std::string arg2 = std::string(argv[nextpos]);
-        params->insert(std::pair<std::string, std::string>("demodSource", "file"));
-        params->insert(std::pair<std::string, std::string>("demodSourceFilepath", arg2));
+        std::string key = arg1 == "--jobs" ? "demodJobs" : (arg1 == "--race" ? "demodRace" : (arg1 == "--channelize" ? "demodChannelize" : (arg1 == "--carrier-timeout" ? "demodCarrierTimeout" : (arg1 == "--cpu" ? "demodCpu" : (arg1 == "--soft" ? "demodSoft" : (arg1 == "--batch-delay" ? "demodBatchDelay" : "demodCaptureFile"))))));
+        params->insert(std::pair<std::string, std::string>(key, arg2));
         return 0;
-    } else if(arg1 == "--source-udp") {
+    } else if(arg1 == "--batch" || arg1 == "--capture" || arg1 == "--capture-control") {
+        std::string arg2 = arg1 == "--batch" ? std::to_string(BATCH_DEFAULT_SIZE) : (arg1 == "--capture" ? std::to_string(CAPTURE_DEFAULT_SECONDS) : std::to_string(CAPTURE_DEFAULT_CONTROL_PORT));
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>(arg1 == "--batch" ? "demodBatch" : (arg1 == "--capture" ? "demodCapture" : "demodCaptureControl"), arg2));
+        return 0;
+    } else if(arg1 == "--auto-tune" || arg1 == "--squelch") {
         std::string arg2;
-        arg2 = "7355";
+        arg2 = arg1 == "--auto-tune" ? std::to_string(CARRIER_DEFAULT_THRESHOLD) : std::to_string(SQUELCH_DEFAULT_THRESHOLD);
         int nextpos = *position + 1;
         if(nextpos < argc and !recursive) {
             int parseRes = parseArg(argc, &nextpos, argv, params, true);
             if(parseRes == 2) {
                 arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
             }
-            *position = nextpos;
         }
-        params->insert(std::pair<std::string, std::string>("demodSource", "udp"));
-        params->insert(std::pair<std::string, std::string>("demodSourceUdpPort", arg2));
+        params->insert(std::pair<std::string, std::string>(arg1 == "--auto-tune" ? "demodAutoTune" : "demodSquelch", arg2));
         return 0;
-    } else if(arg1 == "--source-alsa") {
+    } else if(arg1 == "--discover") {
         std::string arg2;
-        arg2 = "default";
+        arg2 = std::to_string(DISCOVERY_DEFAULT_THRESHOLD);
         int nextpos = *position + 1;
         if(nextpos < argc and !recursive) {
             int parseRes = parseArg(argc, &nextpos, argv, params, true);
             if(parseRes == 2) {
                 arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
             }
-            *position = nextpos;
         }
-        params->insert(std::pair<std::string, std::string>("demodSource", "alsa"));
-        params->insert(std::pair<std::string, std::string>("demodSourceAlsaDev", arg2));
+        params->insert(std::pair<std::string, std::string>("demodDiscover", arg2));
+        return 0;
+    } else if(arg1 == "--prescan") {
+        std::string arg2;
+        arg2 = std::to_string(PRESCAN_DEFAULT_THRESHOLD);
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>("demodPrescan", "true"));
+        params->insert(std::pair<std::string, std::string>("demodPrescanThreshold", arg2));
+        return 0;
+    } else if(arg1 == "--demod-engine") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        params->insert(std::pair<std::string, std::string>("demodEngine", arg2));
         return 0;
     } else if(arg1 == "--out-udp") {
         std::string arg2;
@@ -139,12 +232,250 @@ int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::s
         params->insert(std::pair<std::string, std::string>("demodOutUdpPort", arg3));
         return 0;
     } else {
-        return 2;
+        return parseSourceArg(argc, position, argv, params, recursive, parseArg);
+    }
+}
+
+//sends one chunk in the format selected with outBits(see getOutBits()); soft is used only for soft decisions, freq only when tagged
+void sendDemodChunkViaUdp(uint8_t* symbols, const SoftChunk* soft, int outBits, bool tagged, int32_t freq, SymbolSender* sender, sockaddr_in serveraddr) {
+    if(outBits == 0 && !tagged) {
+        sender->send(symbols, DEMODULATOR_SYMBOLSPERCHUNK, serveraddr);
+        return;
+    }
+    uint8_t datagram[sizeof(TaggedSymbols) + SYMBOLS_MAX_SIZE];
+    int length;
+    if(outBits == 0) {
+        TaggedSymbols tagged;
+        tagged.freq = freq;
+        memcpy(tagged.symbols, symbols, DEMODULATOR_SYMBOLSPERCHUNK);
+        memcpy(datagram, &tagged, sizeof(tagged));
+        length = sizeof(tagged);
+    } else if(outBits == 1) {
+        length = packHardSymbols(symbols, tagged, freq, datagram);
+    } else {
+        length = packSoftSymbols(*soft, outBits, tagged, freq, datagram);
+    }
+    sender->send(datagram, length, serveraddr);
+}
+
+//sender without batching if --batch is not given; returns nullptr if the batch settings are wrong
+SymbolSender* createSymbolSender(std::map<std::string, std::string>& params, int sockfd) {
+    if(params.find("demodBatch") == params.end()) {
+        return new SymbolSender(sockfd, 0, 0);
+    }
+    int size = std::atoi(params["demodBatch"].c_str());
+    int delay = params.find("demodBatchDelay") != params.end() ? std::atoi(params["demodBatchDelay"].c_str()) : BATCH_DEFAULT_DELAY_MS;
+    if(size < 1 || size > BATCH_MAX_SIZE || delay < 0) {
+        std::cout << "Wrong batch size or delay!" << std::endl;
+        return nullptr;
+    }
+    return new SymbolSender(sockfd, size, delay);
+}
+
+//bits per symbol of the out datagrams: 0 for plain symbols(byte per symbol), 1 for --packed, 4 or 8 for --soft; -1 if wrong
+int getOutBits(std::map<std::string, std::string>& params) {
+    bool packed = params.find("demodPacked") != params.end();
+    if(params.find("demodSoft") == params.end()) {
+        return packed ? 1 : 0;
+    }
+    int bits = std::atoi(params["demodSoft"].c_str());
+    if(bits != 4 && bits != 8) {
+        std::cout << "Soft output supports only 4 or 8 bits!" << std::endl;
+        return -1;
     }
+    if(packed) {
+        std::cout << "--packed and --soft can't be used together!" << std::endl;
+        return -1;
+    }
+    //lib engine gives only hard symbols, so are the ones of compare
+    if(params.find("demodEngine") == params.end() || params["demodEngine"] != "fast") {
+        std::cout << "--soft requires --demod-engine fast!" << std::endl;
+        return -1;
+    }
+    return bits;
 }
 
-void sendDemodSymbolsViaUdp(uint8_t data[DEMODULATOR_SYMBOLSPERCHUNK], int sockfd, sockaddr_in serveraddr) {
-    sendto(sockfd, (const char *)data, DEMODULATOR_SYMBOLSPERCHUNK, 0, (const struct sockaddr *) &serveraddr, sizeof(serveraddr));
+static volatile sig_atomic_t captureSignaled = 0;
+
+static void onCaptureSignal(int) {
+    captureSignaled = 1;
+}
+
+//datagrams "capture" or "capture <reason>" write the capture ring
+void runCaptureControl(int sockfd, std::shared_ptr<CaptureRing> capture) {
+    char buf[256];
+    while(true) {
+        int received = recv(sockfd, buf, sizeof(buf), 0);
+        if(received <= 0) {
+            continue;
+        }
+        std::string command(buf, received);
+        if(command.compare(0, 7, "capture") != 0) {
+            continue;
+        }
+        //reason goes to the file name
+        std::string reason;
+        for(size_t i = 8; i < command.size(); i++) {
+            if(std::isalnum((unsigned char)command[i]) || command[i] == '-' || command[i] == '_') {
+                reason += command[i];
+            }
+        }
+        capture->trigger(reason.empty() ? "control" : reason);
+    }
+}
+
+//returns false if the cpu doesn't exist or is not allowed
+bool pinThread(pthread_t thread, int cpu) {
+    if(cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+bool isOutSelected(std::map<std::string, std::string>& params) {
+    return params.find("demodSource") != params.end() && params.find("demodOutUdp") != params.end() && params["demodOutUdp"] == "true" && params.find("demodOutUdpIp") != params.end() && params.find("demodOutUdpPort") != params.end();
+}
+
+sockaddr_in getOutAddr(std::map<std::string, std::string>& params) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::stoi(params["demodOutUdpPort"]));
+    addr.sin_addr.s_addr = inet_addr(params["demodOutUdpIp"].c_str());
+    return addr;
+}
+
+//one source of the multi-source mode
+struct SourceJob {
+    std::map<std::string, std::string> params;
+    std::unique_ptr<SampleSource> source;
+    std::unique_ptr<DemodEngine> demod;
+    sockaddr_in addr;
+    int cpu;
+    int outBits;
+    std::unique_ptr<SymbolSender> sender;
+    std::thread thread;
+    std::mutex statsMtx;
+    std::string stats;
+};
+
+//arguments of every source are separated with --next, the sources are demodulated on separate threads
+int runMultiSource(int argc, char* argv[]) {
+    std::vector<std::unique_ptr<SourceJob>> jobs;
+    int start = 1;
+    while(start <= argc) {
+        int end = start;
+        while(end < argc && std::string(argv[end]) != "--next") {
+            end++;
+        }
+        std::unique_ptr<SourceJob> job(new SourceJob());
+        for(int i = start; i < end; i++) {
+            int res = parseArg(end, &i, argv, &job->params, false);
+            if(res == 1 or res == 2) {
+                std::cout << "Wrong args!" << std::endl;
+                printHelp();
+                return 1;
+            }
+        }
+        if(!jobs.empty()) {
+            //insert() keeps the options given for this source
+            std::map<std::string, std::string>& common = jobs[0]->params;
+            for(std::map<std::string, std::string>::iterator it = common.begin(); it != common.end(); ++it) {
+                if(it->first.compare(0, 11, "demodSource") != 0 && it->first.compare(0, 11, "demodOutUdp") != 0 && it->first != "demodCpu") {
+                    job->params.insert(*it);
+                }
+            }
+        }
+        jobs.push_back(std::move(job));
+        start = end + 1;
+    }
+    for(size_t j = 0; j < jobs.size(); j++) {
+        std::map<std::string, std::string>& params = jobs[j]->params;
+        if(!isOutSelected(params)) {
+            std::cout << "Wrong/No source/out selected for source " << j + 1 << "!" << std::endl;
+            printHelp();
+            return 1;
+        }
+        if(params.find("demodJobs") != params.end() || params.find("demodPrescan") != params.end() || params.find("demodChannelize") != params.end() || params.find("demodCapture") != params.end()) {
+            std::cout << "--jobs, --prescan, --channelize and --capture can't be used with multiple sources!" << std::endl;
+            return 1;
+        }
+        jobs[j]->outBits = getOutBits(params);
+        if(jobs[j]->outBits < 0) {
+            return 1;
+        }
+        jobs[j]->addr = getOutAddr(params);
+        jobs[j]->cpu = params.find("demodCpu") != params.end() ? std::atoi(params["demodCpu"].c_str()) : -1;
+        jobs[j]->demod.reset(createDemodEngine(params));
+        if(!jobs[j]->demod) {
+            return 1;
+        }
+        jobs[j]->source.reset(createSampleSource(params));
+        if(!jobs[j]->source) {
+            return 1;
+        }
+    }
+    int sockfd;
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
+        std::cout << "Socket creation failed!" << std::endl;
+        return 1;
+    }
+    for(size_t j = 0; j < jobs.size(); j++) {
+        jobs[j]->sender.reset(createSymbolSender(jobs[j]->params, sockfd));
+        if(!jobs[j]->sender) {
+            return 1;
+        }
+    }
+    bool isDemodStats = jobs[0]->params.find("demodStats") != jobs[0]->params.end() && jobs[0]->params["demodStats"] == "true";
+    if(isDemodStats) {
+        std::cout << "sample conversion: " << getConvertKernelName() << ", fast demodulator: " << FastDemodulator::getKernelName() << ", sources: " << jobs.size() << std::endl;
+    }
+    std::atomic<int> running(jobs.size());
+    for(size_t j = 0; j < jobs.size(); j++) {
+        SourceJob* job = jobs[j].get();
+        job->thread = std::thread([job, j, isDemodStats, &running]() {
+            if(job->cpu >= 0 && !pinThread(pthread_self(), job->cpu)) {
+                std::cout << "Can't pin source " << j + 1 << " to cpu " << job->cpu << "!" << std::endl;
+            }
+            std::complex<double>* samples;
+            int samplesRead;
+            std::vector<SoftChunk> soft;
+            while((samplesRead = job->source->read(&samples)) > 0) {
+                soft.clear();
+                std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = job->demod->demodulate(samples, samplesRead, job->outBits > 1 ? &soft : nullptr);
+                if(isDemodStats) {
+                    std::ostringstream os;
+                    os << "[" << j + 1 << "] freq = " << job->demod->getCenterFreq() << " sync = " << (job->demod->getIsInSync() ? "true" : "false") << job->demod->getStats() << job->source->getStats() << job->sender->getStats();
+                    std::lock_guard<std::mutex> lock(job->statsMtx);
+                    job->stats = os.str();
+                }
+                for(int d = 0; d < (int)res.size(); d++) {
+                    sendDemodChunkViaUdp(res[d].bitsDemodulated, job->outBits > 1 ? &soft[d] : nullptr, job->outBits, false, 0, job->sender.get(), job->addr);
+                }
+                job->sender->poll();
+            }
+            job->sender->flush();
+            running--;
+        });
+    }
+    while(running > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(MULTI_STATS_INTERVAL_MS));
+        if(isDemodStats) {
+            std::string line;
+            for(size_t j = 0; j < jobs.size(); j++) {
+                std::lock_guard<std::mutex> lock(jobs[j]->statsMtx);
+                line += (j > 0 ? " | " : "") + jobs[j]->stats;
+            }
+            std::cout << line << "     \r" << std::flush;
+        }
+    }
+    for(size_t j = 0; j < jobs.size(); j++) {
+        jobs[j]->thread.join();
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -153,6 +484,11 @@ int main(int argc, char* argv[]) {
         printHelp();
         return 1;
     }
+    for(int i = 1; i < argc; i++) {
+        if(std::string(argv[i]) == "--next") {
+            return runMultiSource(argc, argv);
+        }
+    }
     for(int i = 1; i < argc; i++) {
         int res = parseArg(argc, &i, argv, &params, false);
         if(res == 1 or res == 2) {
@@ -162,191 +498,189 @@ int main(int argc, char* argv[]) {
         }
     }
     bool isDemodStats = params.find("demodStats") != params.end() && params["demodStats"] == "true";
-    if(params.find("demodSource") == params.end() || params.find("demodOutUdp") == params.end() || params["demodOutUdp"] != "true" || params.find("demodOutUdpIp") == params.end() || params.find("demodOutUdpPort") == params.end()) {
+    if(!isOutSelected(params)) {
         std::cout << "Wrong/No source/out selected!" << std::endl;
         printHelp();
         return 1;
     }
-    std::string demodSource = params["demodSource"];
-    std::string udpIp = params["demodOutUdpIp"];
-    std::string udpPort = params["demodOutUdpPort"];
-    sockaddr_in clientaddr;
-    memset(&clientaddr, 0, sizeof(clientaddr));
-    // Filling server information
-    clientaddr.sin_family = AF_INET;
-    clientaddr.sin_port = htons(std::stoi(udpPort));
-    clientaddr.sin_addr.s_addr=inet_addr(udpIp.c_str());
-    inmarsatc::demodulator::Demodulator demod;
-    if(params.find("demodLoFreq") != params.end()) {
-        int loFreq = std::atoi(params["demodLoFreq"].c_str());
-        demod.setLowFreq(loFreq);
-    }
-    if(params.find("demodHiFreq") != params.end()) {
-        int hiFreq = std::atoi(params["demodHiFreq"].c_str());
-        demod.setHighFreq(hiFreq);
-    }
-    if(params.find("demodCentFreq") != params.end()) {
-        int centFreq = std::atoi(params["demodCentFreq"].c_str());
-        demod.setCenterFreq(centFreq);
+    sockaddr_in clientaddr = getOutAddr(params);
+    int outBits = getOutBits(params);
+    if(outBits < 0) {
+        return 1;
     }
     int sockfd;
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
         std::cout << "Socket creation failed!" << std::endl;
         return 1;
     }
-    if(demodSource == "file") {
-        if(params.find("demodSourceFilepath") == params.end()) {
-            std::cout << "File path not specified!" << std::endl;
-            return 1;
-        }
-        std::string filePath = params["demodSourceFilepath"];
-        AFfilehandle file = afOpenFile(filePath.c_str(), "r", AF_NULL_FILESETUP);
-        int channels = afGetChannels(file, AF_DEFAULT_TRACK);
-        double rate = afGetRate(file, AF_DEFAULT_TRACK);
-        afSetVirtualSampleFormat(file, AF_DEFAULT_TRACK, AF_SAMPFMT_TWOSCOMP, 16);
-        if(channels != 1 or rate != 48000) {
-            std::cout << "Wrong file format! It should be 48k, 1 channel." << std::endl;
+    std::unique_ptr<SymbolSender> sender(createSymbolSender(params, sockfd));
+    if(!sender) {
+        return 1;
+    }
+    if(params.find("demodChannelize") == params.end() && (params.find("demodDiscover") != params.end() || params.find("demodChannels") != params.end())) {
+        std::cout << "--discover and --channel require --channelize!" << std::endl;
+        return 1;
+    }
+    std::shared_ptr<CaptureRing> capture;
+    if(params.find("demodCapture") != params.end()) {
+        double seconds = std::atof(params["demodCapture"].c_str());
+        if(seconds <= 0 || params.find("demodChannelize") != params.end() || params.find("demodJobs") != params.end()) {
+            std::cout << "Wrong capture time or capture used with --channelize or --jobs!" << std::endl;
             return 1;
         }
-        int16_t buf[BUFSIZE];
-        AFframecount framesRead;
-        while(true) {
-            framesRead = afReadFrames(file, AF_DEFAULT_TRACK, buf, BUFSIZE);
-            if(framesRead <= 0) {
-                return 0;
-            }
-            std::complex<double> cbuf[framesRead];
-            for(int i = 0; i < framesRead; i+= 1) {
-                double val = buf[i];
-                cbuf[i] = std::complex<double>(val,val);
+        capture.reset(new CaptureRing(seconds, params.find("demodCaptureFile") != params.end() ? params["demodCaptureFile"] : CAPTURE_DEFAULT_PREFIX));
+        signal(SIGUSR1, onCaptureSignal);
+        if(params.find("demodCaptureControl") != params.end()) {
+            int controlfd;
+            if ((controlfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
+                std::cout << "Socket creation failed!" << std::endl;
+                return 1;
             }
-            std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod.demodulate(cbuf, framesRead);
-            if(isDemodStats) {
-                std::cout << "freq = " << demod.getCenterFreq() << " sync = " << (demod.getIsInSync() ? "true" : "false") << "     \r" << std::flush;
+            sockaddr_in controladdr;
+            memset(&controladdr, 0, sizeof(controladdr));
+            controladdr.sin_family = AF_INET;
+            controladdr.sin_port = htons(std::stoi(params["demodCaptureControl"]));
+            controladdr.sin_addr.s_addr = INADDR_ANY;
+            if (bind(controlfd, (const struct sockaddr *)&controladdr, sizeof(controladdr)) < 0) {
+                std::cout << "Binding to port failed!" << std::endl;
+                return 1;
             }
-            if(res.size() > 0) {
-                for(int d = 0; d < (int)res.size(); d++) {
-                    sendDemodSymbolsViaUdp(res[d].bitsDemodulated, sockfd, clientaddr);
-                }
+            std::thread(runCaptureControl, controlfd, capture).detach();
+        }
+    } else if(params.find("demodCaptureControl") != params.end() || params.find("demodCaptureFile") != params.end()) {
+        std::cout << "--capture-control and --capture-file require --capture!" << std::endl;
+        return 1;
+    }
+    if(params.find("demodChannelize") != params.end()) {
+        int jobs = params.find("demodJobs") != params.end() ? std::atoi(params["demodJobs"].c_str()) : std::thread::hardware_concurrency();
+        if(jobs < 1) {
+            jobs = 1;
+        }
+        if(params.find("demodDiscover") != params.end()) {
+            if(params.find("demodChannels") != params.end() || params.find("demodPrescan") != params.end()) {
+                std::cout << "Discover can't be used with --channel and prescan!" << std::endl;
+                return 1;
             }
+            double timeout = params.find("demodCarrierTimeout") != params.end() ? std::atof(params["demodCarrierTimeout"].c_str()) : DISCOVERY_DEFAULT_TIMEOUT;
+            bool ok = runDiscoveryDemod(params, std::atoi(params["demodChannelize"].c_str()), std::atof(params["demodDiscover"].c_str()), timeout, jobs, [&](double freq, uint8_t* data, const SoftChunk* soft) {
+                sendDemodChunkViaUdp(data, soft, outBits, true, (int32_t)std::lround(freq), sender.get(), clientaddr);
+            }, [&]() {
+                sender->poll();
+                return sender->getStats();
+            }, isDemodStats);
+            sender->flush();
+            return ok ? 0 : 1;
         }
-    } else if(demodSource == "udp") {
-        if(params.find("demodSourceUdpPort") == params.end()) {
-            std::cout << "Udp port not specified!" << std::endl;
+        std::vector<ChannelConfig> configs;
+        std::istringstream is(params["demodChannels"]);
+        ChannelConfig config;
+        while(is >> config.freq >> config.port) {
+            configs.push_back(config);
+        }
+        if(configs.empty() || params.find("demodPrescan") != params.end()) {
+            std::cout << "Channelize requires --channel or --discover and can't be used with prescan!" << std::endl;
             return 1;
         }
-        std::string udpPort = params["demodSourceUdpPort"];
-        int clisockfd;
-        if ((clisockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
-            std::cout << "Socket creation failed!" << std::endl;
+        std::vector<sockaddr_in> channelAddrs(configs.size(), clientaddr);
+        for(size_t i = 0; i < configs.size(); i++) {
+            channelAddrs[i].sin_port = htons(configs[i].port);
+        }
+        bool ok = runChannelizedDemod(params, std::atoi(params["demodChannelize"].c_str()), configs, jobs, [&](int index, uint8_t* data, const SoftChunk* soft) {
+            sendDemodChunkViaUdp(data, soft, outBits, false, 0, sender.get(), channelAddrs[index]);
+        }, [&]() {
+            sender->poll();
+            return sender->getStats();
+        }, isDemodStats);
+        sender->flush();
+        return ok ? 0 : 1;
+    }
+    std::vector<SignalRegion> regions;
+    bool isPrescan = params.find("demodPrescan") != params.end();
+    if(isPrescan) {
+        if(params["demodSource"] != "file") {
+            std::cout << "Prescan requires file source!" << std::endl;
             return 1;
         }
-        // Filling server information
-        sockaddr_in serveraddr, cliaddr;
-        serveraddr.sin_family = AF_INET;
-        serveraddr.sin_port = htons(std::stoi(udpPort));
-        serveraddr.sin_addr.s_addr=INADDR_ANY;
-        if (bind(clisockfd, (const struct sockaddr *)&serveraddr, sizeof(serveraddr)) < 0) {
-                std::cout << "Binding to port failed!" << std::endl;
-                return 1;
+        PrescanStats prescanStats;
+        if(!prescanRecording(params, std::atof(params["demodPrescanThreshold"].c_str()), &regions, &prescanStats)) {
+            return 1;
         }
-        int16_t buf[BUFSIZE];
-        int received;
-        socklen_t len_useless = sizeof(cliaddr);
-        while(true) {
-            received = recvfrom(clisockfd, (char *)buf, (BUFSIZE*2), MSG_WAITALL, ( struct sockaddr *) &cliaddr, &len_useless);
-            received = received / 2;//char to int16_t
-            if(received <= 0) {
-                return 0;
-            }
-            std::complex<double> cbuf[received];
-            for(int i = 0; i < received; i+= 1) {
-                double val = buf[i];
-                cbuf[i] = std::complex<double>(val,val);
-            }
-            std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod.demodulate(cbuf, received);
-            if(isDemodStats) {
-                std::cout << "freq = " << demod.getCenterFreq() << " sync = " << (demod.getIsInSync() ? "true" : "false") << "     \r" << std::flush;
-            }
-            if(res.size() > 0) {
-                for(int d = 0; d < (int)res.size(); d++) {
-                    sendDemodSymbolsViaUdp(res[d].bitsDemodulated, sockfd, clientaddr);
-                }
-            }
+        std::cout << "prescan: carrier in " << prescanStats.presentBlocks << " of " << prescanStats.blocks << " blocks, demodulating " << prescanStats.presentSeconds << " of " << prescanStats.recordingSeconds << " s in " << regions.size() << " regions, scanned in " << prescanStats.wallSeconds << " s" << std::endl;
+        if(regions.empty()) {
+            return 0;
         }
-    } else if(demodSource == "alsa") {
-        if(params.find("demodSourceAlsaDev") == params.end()) {
-            std::cout << "Alsa device not specified!" << std::endl;
+    }
+    if(params.find("demodJobs") != params.end()) {
+        if(outBits > 1) {
+            std::cout << "Soft output can't be used with --jobs!" << std::endl;
             return 1;
         }
-        std::string alsaDev = params["demodSourceAlsaDev"];
-        int err;
-        unsigned int rate = 48000;
-        snd_pcm_t *capture_handle;
-        snd_pcm_hw_params_t *hw_params;
-        snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
-        if ((err = snd_pcm_open (&capture_handle, alsaDev.c_str(), SND_PCM_STREAM_CAPTURE, 0)) < 0) {
-            fprintf (stderr, "cannot open audio device %s (%s)\n", "", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_malloc (&hw_params)) < 0) {
-            fprintf (stderr, "cannot allocate hardware parameter structure (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_any (capture_handle, hw_params)) < 0) {
-            fprintf (stderr, "cannot initialize hardware parameter structure (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_set_access (capture_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
-            fprintf (stderr, "cannot set access type (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_set_format (capture_handle, hw_params, format)) < 0) {
-            fprintf (stderr, "cannot set sample format (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_set_rate_near (capture_handle, hw_params, &rate, 0)) < 0) {
-            fprintf (stderr, "cannot set sample rate (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params_set_channels (capture_handle, hw_params, 1)) < 0) {
-            fprintf (stderr, "cannot set channel count (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        if ((err = snd_pcm_hw_params (capture_handle, hw_params)) < 0) {
-            fprintf (stderr, "cannot set parameters (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        snd_pcm_hw_params_free (hw_params);
-        if ((err = snd_pcm_prepare (capture_handle)) < 0) {
-            fprintf (stderr, "cannot prepare audio interface for use (%s)\n", snd_strerror (err));
-            exit (1);
-        }
-        int framesRead;
-        int16_t buf[BUFSIZE];
-        while(true) {
-            framesRead = (snd_pcm_readi (capture_handle, buf, BUFSIZE));
-            if(framesRead <= 0) {
-                break;
-            }
-            std::complex<double> cbuf[framesRead];
-            for(int i = 0; i < framesRead; i+= 1) {
-                double val = buf[i];
-                cbuf[i] = std::complex<double>(val,val);
+        int jobs = std::atoi(params["demodJobs"].c_str());
+        if(jobs < 1 || params["demodSource"] != "file") {
+            std::cout << "Wrong jobs count or not a file source!" << std::endl;
+            return 1;
+        }
+        SegmentedDemodStats stats;
+        bool ok = runSegmentedDemod(params, jobs, regions, [&](uint8_t* data) {
+            sendDemodChunkViaUdp(data, nullptr, outBits, false, 0, sender.get(), clientaddr);
+        }, &stats);
+        sender->flush();
+        if(!ok) {
+            return 1;
+        }
+        std::cout << "segments: " << stats.segments << ", aligned seams: " << stats.alignedSeams << ", unaligned seams: " << stats.unalignedSeams << std::endl;
+        std::cout << "processed " << stats.recordingSeconds << " s of recording in " << stats.wallSeconds << " s, realtime factor: " << stats.recordingSeconds / stats.wallSeconds << std::endl;
+        return 0;
+    }
+    //channelize and jobs modes create their own engines
+    std::unique_ptr<DemodEngine> demod(createDemodEngine(params));
+    if(!demod) {
+        return 1;
+    }
+    std::unique_ptr<SampleSource> source(createSampleSource(params, capture));
+    if(!source) {
+        return 1;
+    }
+    if(capture) {
+        std::cout << "capture: last " << params["demodCapture"] << " s of input in " << capture->getSizeMb() << " MB" << std::endl;
+    }
+    if(isPrescan) {
+        source.reset(new RegionSampleSource(source.release(), regions));
+    }
+    if(isDemodStats) {
+        std::cout << "sample conversion: " << getConvertKernelName() << ", fast demodulator: " << FastDemodulator::getKernelName() << ", symbol packing: " << getSymbolPackKernelName() << std::endl;
+    }
+    //pinned after the source and the demodulator are created, so their own threads are not
+    if(params.find("demodCpu") != params.end() && !pinThread(pthread_self(), std::atoi(params["demodCpu"].c_str()))) {
+        std::cout << "Can't pin to cpu " << params["demodCpu"] << "!" << std::endl;
+    }
+    std::complex<double>* samples;
+    int samplesRead;
+    std::vector<SoftChunk> soft;
+    bool wasInSync = false;
+    while((samplesRead = source->read(&samples)) > 0) {
+        soft.clear();
+        std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod->demodulate(samples, samplesRead, outBits > 1 ? &soft : nullptr);
+        if(capture) {
+            if(captureSignaled) {
+                captureSignaled = 0;
+                capture->trigger("signal");
             }
-            std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod.demodulate(cbuf, framesRead);
-            if(isDemodStats) {
-                std::cout << "freq = " << demod.getCenterFreq() << " sync = " << (demod.getIsInSync() ? "true" : "false") << "     \r" << std::flush;
+            if(wasInSync && !demod->getIsInSync()) {
+                capture->trigger("syncloss");
             }
-            if(res.size() > 0) {
-                for(int d = 0; d < (int)res.size(); d++) {
-                    sendDemodSymbolsViaUdp(res[d].bitsDemodulated, sockfd, clientaddr);
-                }
+            wasInSync = demod->getIsInSync();
+        }
+        if(res.size() > 0) {
+            for(int d = 0; d < (int)res.size(); d++) {
+                sendDemodChunkViaUdp(res[d].bitsDemodulated, outBits > 1 ? &soft[d] : nullptr, outBits, false, 0, sender.get(), clientaddr);
             }
         }
-        snd_pcm_close (capture_handle);
-    } else {
-        std::cout << "Wrong or none demodulator source!" << std::endl;
-        return 1;
+        sender->poll();
+        if(isDemodStats) {
+            std::cout << "freq = " << demod->getCenterFreq() << " sync = " << (demod->getIsInSync() ? "true" : "false") << demod->getStats() << source->getStats() << sender->getStats() << "     \r" << std::flush;
+        }
     }
+    sender->flush();
+    return 0;
 }
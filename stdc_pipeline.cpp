@@ -0,0 +1,207 @@
+#include <iostream>
+#include <inmarsatc_demodulator.h>
+#include <inmarsatc_decoder.h>
+#include <inmarsatc_parser.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <map>
+#include <memory>
+#include <thread>
+#include "sample_source.h"
+#include "demod_engine.h"
+#include "parser_output.h"
+#include "bounded_queue.h"
+
+#define TOLERANCE 9
+//demodulator results are ~5KB each, so 256 chunks is about 1 minute of symbols
+#define SYMBOLS_QUEUE_SIZE 256
+#define FRAMES_QUEUE_SIZE 256
+
+void printHelp() {
+    std::cout << "Help: " << std::endl;
+    std::cout << "stdc_pipeline - open-source cli program to demodulate, decode and parse inmarsat-C signals in one process using inmarsatc library based on Scytale-C source code" << std::endl;
+    std::cout << "Keys: " << std::endl;
+    std::cout << "--help                                    - this help" << std::endl;
+    std::cout << "--lo-freq <freq>                          - set demodulator low frequency. default: 500" << std::endl;
+    std::cout << "--hi-freq <freq>                          - set demodulator high frequency. default: 4500" << std::endl;
+    std::cout << "--cent-freq <freq>                        - set demodulator initial center frequency. default: 2600" << std::endl;
+    std::cout << "--stats                                   - print demodulator statistics(frequency, etc...)" << std::endl;
+    std::cout << "--demod-engine <lib/fast/compare>         - select demodulator: inmarsatc library, in-tree single precision one or both with symbols comparison. default: lib" << std::endl;
+    std::cout << "--auto-tune <threshold>                   - find the carrier with fft at start and after sync loss and tune the demodulator to it. default threshold: 8 dB" << std::endl;
+    std::cout << "--race <n>                                - run n demodulators at frequencies spread across lo..hi on parallel threads and use the one which gets in sync first" << std::endl;
+    std::cout << "--squelch <threshold>                     - demodulate only while the level of lo..hi band is over the threshold, the last second before is demodulated too. noise is measured on the band widened to 3x the carrier(~5 kHz). default threshold: 3 dB" << std::endl;
+    printSourceHelp();
+    std::cout << "--verbose                                 - print all data for all parsed packets" << std::endl;
+    std::cout << "--print-all-packets                       - parse data for any packets type(otherwise just message packets)" << std::endl;
+    std::cout << "--out-udp <ip> <port>                     - output parsed packets via udp JSON(default: 127.0.0.1 15005)" << std::endl;
+    std::cout << "(one source should be selected)" << std::endl;
+}
+
+int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive) {
+    std::string arg1 = std::string(argv[*position]);
+    if(arg1 == "--help") {
+        return 1;
+    } else if(arg1 == "--stats") {
+        params->insert(std::pair<std::string, std::string>("demodStats", "true"));
+        return 0;
+    } else if(arg1 == "--verbose") {
+        params->insert(std::pair<std::string, std::string>("frameparserVerbose", "true"));
+        return 0;
+    } else if(arg1 == "--print-all-packets") {
+        params->insert(std::pair<std::string, std::string>("frameparserPrintAllPackets", "true"));
+        return 0;
+    } else if(arg1 == "--lo-freq" || arg1 == "--hi-freq" || arg1 == "--cent-freq" || arg1 == "--demod-engine" || arg1 == "--race") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        std::string key = arg1 == "--lo-freq" ? "demodLoFreq" : (arg1 == "--hi-freq" ? "demodHiFreq" : (arg1 == "--cent-freq" ? "demodCentFreq" : (arg1 == "--demod-engine" ? "demodEngine" : "demodRace")));
+        params->insert(std::pair<std::string, std::string>(key, arg2));
+        return 0;
+    } else if(arg1 == "--auto-tune" || arg1 == "--squelch") {
+        std::string arg2;
+        arg2 = arg1 == "--auto-tune" ? std::to_string(CARRIER_DEFAULT_THRESHOLD) : std::to_string(SQUELCH_DEFAULT_THRESHOLD);
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>(arg1 == "--auto-tune" ? "demodAutoTune" : "demodSquelch", arg2));
+        return 0;
+    } else if(arg1 == "--out-udp") {
+        std::string arg2;
+        std::string arg3;
+        arg2 = "127.0.0.1";
+        arg3 = "15005";
+        int nextpos = *position + 1;
+        if(nextpos < argc and !recursive) {
+            int parseRes = parseArg(argc, &nextpos, argv, params, true);
+            if(parseRes == 2) {
+                arg2 = std::string(argv[nextpos]);
+            }
+            *position = nextpos;
+            nextpos++;
+            if(nextpos < argc) {
+                parseRes = parseArg(argc, &nextpos, argv, params, true);
+                if(parseRes == 2) {
+                    arg3 = std::string(argv[nextpos]);
+                }
+                *position = nextpos;
+            }
+        }
+        params->insert(std::pair<std::string, std::string>("frameparserOutUdp", "true"));
+        params->insert(std::pair<std::string, std::string>("frameparserOutUdpIp", arg2));
+        params->insert(std::pair<std::string, std::string>("frameparserOutUdpPort", arg3));
+        return 0;
+    } else {
+        return parseSourceArg(argc, position, argv, params, recursive, parseArg);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, std::string> params;
+    if(argc < 2) {
+        printHelp();
+        return 1;
+    }
+    for(int i = 1; i < argc; i++) {
+        int res = parseArg(argc, &i, argv, &params, false);
+        if(res == 1 or res == 2) {
+            std::cout << "Wrong args!" << std::endl;
+            printHelp();
+            return 1;
+        }
+    }
+    bool isDemodStats = params.find("demodStats") != params.end() && params["demodStats"] == "true";
+    bool isFrameparserVerbose = params.find("frameparserVerbose") != params.end() && params["frameparserVerbose"] == "true";
+    bool isFrameparserPrintAllPackets = params.find("frameparserPrintAllPackets") != params.end() && params["frameparserPrintAllPackets"] == "true";
+    bool isFrameparserOutUdp = params.find("frameparserOutUdp") != params.end() && params["frameparserOutUdp"] == "true";
+    sockaddr_in clientaddr;
+    int sockfd = -1;
+    if(isFrameparserOutUdp) {
+        std::string udpIp = params["frameparserOutUdpIp"];
+        std::string udpPort = params["frameparserOutUdpPort"];
+        memset(&clientaddr, 0, sizeof(clientaddr));
+        // Filling server information
+        clientaddr.sin_family = AF_INET;
+        clientaddr.sin_port = htons(std::stoi(udpPort));
+        clientaddr.sin_addr.s_addr=inet_addr(udpIp.c_str());
+        if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) {
+            std::cout << "Socket creation failed!" << std::endl;
+            return 1;
+        }
+    }
+    if(params.find("demodSource") == params.end()) {
+        std::cout << "Wrong/No source selected!" << std::endl;
+        printHelp();
+        return 1;
+    }
+    std::unique_ptr<DemodEngine> demod(createDemodEngine(params));
+    if(!demod) {
+        return 1;
+    }
+    std::unique_ptr<SampleSource> source(createSampleSource(params));
+    if(!source) {
+        return 1;
+    }
+    inmarsatc::decoder::Decoder decoder(TOLERANCE);
+    inmarsatc::frameParser::FrameParser parser;
+    BoundedQueue<inmarsatc::demodulator::Demodulator::demodulator_result> symbolsQueue(SYMBOLS_QUEUE_SIZE);
+    BoundedQueue<inmarsatc::decoder::Decoder::decoder_result> framesQueue(FRAMES_QUEUE_SIZE);
+
+    std::thread demodThread([&]() {
+        std::complex<double>* samples;
+        int samplesRead;
+        while((samplesRead = source->read(&samples)) > 0) {
+            std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod->demodulate(samples, samplesRead);
+            if(isDemodStats) {
+                std::cout << "freq = " << demod->getCenterFreq() << " sync = " << (demod->getIsInSync() ? "true" : "false") << demod->getStats() << source->getStats() << "     \r" << std::flush;
+            }
+            for(int d = 0; d < (int)res.size(); d++) {
+                symbolsQueue.push(res[d]);
+            }
+        }
+        symbolsQueue.close();
+    });
+    std::thread decoderThread([&]() {
+        inmarsatc::demodulator::Demodulator::demodulator_result syms;
+        while(symbolsQueue.pop(syms)) {
+            std::vector<inmarsatc::decoder::Decoder::decoder_result> dec_res = decoder.decode(syms.bitsDemodulated);
+            for(int i = 0; i < (int)dec_res.size(); i++) {
+                framesQueue.push(dec_res[i]);
+            }
+        }
+        framesQueue.close();
+    });
+    std::thread parserThread([&]() {
+        inmarsatc::decoder::Decoder::decoder_result frame;
+        while(framesQueue.pop(frame)) {
+            std::vector<inmarsatc::frameParser::FrameParser::frameParser_result> pack_dec_res_vec = parser.parseFrame(frame);
+            for(int k = 0; k < (int)pack_dec_res_vec.size(); k++) {
+                inmarsatc::frameParser::FrameParser::frameParser_result pack_dec_res = pack_dec_res_vec[k];
+                if(!pack_dec_res.decoding_result.isDecodedPacket || !pack_dec_res.decoding_result.isCrc) {
+                    continue;
+                }
+                printFrameParserPacket(pack_dec_res, isFrameparserPrintAllPackets, isFrameparserVerbose);
+                if(isFrameparserOutUdp) {
+                    if(isFrameparserPrintAllPackets || ifPacketIsMessage(pack_dec_res)) {
+                        sendParserDataViaUdp(frameParserPacketToJson(pack_dec_res), sockfd, clientaddr);
+                    }
+                }
+            }
+        }
+    });
+    demodThread.join();
+    decoderThread.join();
+    parserThread.join();
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <inmarsatc_demodulator.h>
+#include <inmarsatc_decoder.h>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include "sample_source.h"
+#include "demod_engine.h"
+
+#define TOLERANCE 9
+
+struct SweepPoint {
+    int centFreq;
+    int loFreq;
+    int hiFreq;
+    //seconds until the first sync, -1 if never
+    double timeToSync;
+    double syncFraction;
+    int frames;
+    int uncertainFrames;
+};
+
+void printHelp() {
+    std::cout << "Help: " << std::endl;
+    std::cout << "stdc_sweep - open-source cli program to find the best demodulator frequency settings for a recording using inmarsatc library based on Scytale-C source code" << std::endl;
+    std::cout << "Keys: " << std::endl;
+    std::cout << "--help                                    - this help" << std::endl;
+    std::cout << "--cent-freq <from> <to> <step>            - grid of demodulator initial center frequencies. default: 2600" << std::endl;
+    std::cout << "--lo-freq <from> <to> <step>              - grid of demodulator low frequencies. default: 500" << std::endl;
+    std::cout << "--hi-freq <from> <to> <step>              - grid of demodulator high frequencies. default: 4500" << std::endl;
+    std::cout << "(single value can be given instead of the grid)" << std::endl;
+    std::cout << "--demod-engine <lib/fast>                 - select demodulator: inmarsatc library or in-tree single precision one. default: lib" << std::endl;
+    std::cout << "--jobs <n>                                - count of grid points processed in parallel. default: count of cpu cores" << std::endl;
+    std::cout << "--duration <seconds>                      - process only the beginning of the recording. default: whole recording" << std::endl;
+    printSourceHelp();
+    std::cout << "(file source should be selected)" << std::endl;
+}
+
+int parseArg(int argc, int* position, char* argv[], std::map<std::string, std::string>* params, bool recursive) {
+    std::string arg1 = std::string(argv[*position]);
+    if(arg1 == "--help") {
+        return 1;
+    } else if(arg1 == "--cent-freq" || arg1 == "--lo-freq" || arg1 == "--hi-freq") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        //1 or 3 values
+        std::string values;
+        int count = 0;
+        while(count < 3 && nextpos < argc && parseArg(argc, &nextpos, argv, params, true) == 2) {
+            values += (count > 0 ? " " : "") + std::string(argv[nextpos]);
+            *position = nextpos;
+            nextpos++;
+            count++;
+        }
+        if(count != 1 && count != 3) {
+            return 1;
+        }
+        std::string key = arg1 == "--cent-freq" ? "sweepCentFreq" : (arg1 == "--lo-freq" ? "sweepLoFreq" : "sweepHiFreq");
+        params->insert(std::pair<std::string, std::string>(key, values));
+        return 0;
+    } else if(arg1 == "--demod-engine" || arg1 == "--jobs" || arg1 == "--duration") {
+        int nextpos = *position + 1;
+        if(nextpos >= argc or recursive) {
+            return 1;
+        }
+        int parseRes = parseArg(argc, &nextpos, argv, params, true);
+        if(parseRes != 2) {
+            return 1;
+        }
+        *position = nextpos;
+        std::string arg2 = std::string(argv[nextpos]);
+        std::string key = arg1 == "--demod-engine" ? "demodEngine" : (arg1 == "--jobs" ? "sweepJobs" : "sweepDuration");
+        params->insert(std::pair<std::string, std::string>(key, arg2));
+        return 0;
+    } else {
+        return parseSourceArg(argc, position, argv, params, recursive, parseArg);
+    }
+}
+
+//parses "value" or "from to step"; returns false for wrong grid
+bool parseGrid(std::string grid, std::vector<int>* values) {
+    std::istringstream is(grid);
+    int from, to, step;
+    if(!(is >> from)) {
+        return false;
+    }
+    if(!(is >> to >> step)) {
+        values->push_back(from);
+        return true;
+    }
+    if(step <= 0 || to < from) {
+        return false;
+    }
+    for(int v = from; v <= to; v += step) {
+        values->push_back(v);
+    }
+    return true;
+}
+
+void runSweepPoint(std::map<std::string, std::string> params, double duration, SweepPoint* point) {
+    params["demodCentFreq"] = std::to_string(point->centFreq);
+    params["demodLoFreq"] = std::to_string(point->loFreq);
+    params["demodHiFreq"] = std::to_string(point->hiFreq);
+    point->timeToSync = -1;
+    point->syncFraction = 0;
+    point->frames = 0;
+    point->uncertainFrames = 0;
+    std::unique_ptr<SampleSource> source(createSampleSource(params));
+    std::unique_ptr<DemodEngine> demod(createDemodEngine(params));
+    if(!source || !demod) {
+        return;
+    }
+    inmarsatc::decoder::Decoder decoder(TOLERANCE);
+    double rate = source->getSampleRate();
+    long long limit = duration > 0 ? (long long)(duration * rate) : -1;
+    long long processed = 0;
+    long long inSync = 0;
+    std::complex<double>* samples;
+    int samplesRead;
+    while((limit < 0 || processed < limit) && (samplesRead = source->read(&samples)) > 0) {
+        std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod->demodulate(samples, samplesRead);
+        processed += samplesRead;
+        if(demod->getIsInSync()) {
+            inSync += samplesRead;
+            if(point->timeToSync < 0) {
+                point->timeToSync = processed / rate;
+            }
+        }
+        for(int d = 0; d < (int)res.size(); d++) {
+            std::vector<inmarsatc::decoder::Decoder::decoder_result> dec_res = decoder.decode(res[d].bitsDemodulated);
+            for(int i = 0; i < (int)dec_res.size(); i++) {
+                point->frames++;
+                if(dec_res[i].isUncertain) {
+                    point->uncertainFrames++;
+                }
+            }
+        }
+    }
+    point->syncFraction = processed > 0 ? (double)inSync / processed : 0;
+}
+
+//more good frames, then more time in sync, then faster sync
+bool isBetterPoint(const SweepPoint& a, const SweepPoint& b) {
+    int goodA = a.frames - a.uncertainFrames;
+    int goodB = b.frames - b.uncertainFrames;
+    if(goodA != goodB) {
+        return goodA > goodB;
+    }
+    if(a.syncFraction != b.syncFraction) {
+        return a.syncFraction > b.syncFraction;
+    }
+    if((a.timeToSync < 0) != (b.timeToSync < 0)) {
+        return b.timeToSync < 0;
+    }
+    return a.timeToSync < b.timeToSync;
+}
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, std::string> params;
+    if(argc < 2) {
+        printHelp();
+        return 1;
+    }
+    for(int i = 1; i < argc; i++) {
+        int res = parseArg(argc, &i, argv, &params, false);
+        if(res == 1 or res == 2) {
+            std::cout << "Wrong args!" << std::endl;
+            printHelp();
+            return 1;
+        }
+    }
+    if(params.find("demodSource") == params.end() || params["demodSource"] != "file") {
+        std::cout << "Wrong/No source selected!" << std::endl;
+        printHelp();
+        return 1;
+    }
+    std::vector<int> centFreqs, loFreqs, hiFreqs;
+    if(!parseGrid(params.find("sweepCentFreq") != params.end() ? params["sweepCentFreq"] : "2600", &centFreqs) ||
+       !parseGrid(params.find("sweepLoFreq") != params.end() ? params["sweepLoFreq"] : "500", &loFreqs) ||
+       !parseGrid(params.find("sweepHiFreq") != params.end() ? params["sweepHiFreq"] : "4500", &hiFreqs)) {
+        std::cout << "Wrong frequency grid!" << std::endl;
+        return 1;
+    }
+    if(params.find("demodEngine") != params.end() && params["demodEngine"] == "compare") {
+        std::cout << "Compare engine can't be swept!" << std::endl;
+        return 1;
+    }
+    int jobs = std::thread::hardware_concurrency();
+    if(params.find("sweepJobs") != params.end()) {
+        jobs = std::atoi(params["sweepJobs"].c_str());
+    }
+    if(jobs < 1) {
+        jobs = 1;
+    }
+    double duration = params.find("sweepDuration") != params.end() ? std::atof(params["sweepDuration"].c_str()) : 0;
+    //check the source and the engine once, before the workers print the same errors
+    {
+        std::unique_ptr<DemodEngine> demod(createDemodEngine(params));
+        std::unique_ptr<SampleSource> source(createSampleSource(params));
+        if(!demod || !source) {
+            return 1;
+        }
+        if(source->getLength() <= 0) {
+            std::cout << "Sweep requires a recording as the source!" << std::endl;
+            return 1;
+        }
+    }
+    std::vector<SweepPoint> points;
+    for(size_t c = 0; c < centFreqs.size(); c++) {
+        for(size_t l = 0; l < loFreqs.size(); l++) {
+            for(size_t h = 0; h < hiFreqs.size(); h++) {
+                if(loFreqs[l] >= centFreqs[c] || hiFreqs[h] <= centFreqs[c]) {
+                    continue;
+                }
+                SweepPoint point;
+                point.centFreq = centFreqs[c];
+                point.loFreq = loFreqs[l];
+                point.hiFreq = hiFreqs[h];
+                points.push_back(point);
+            }
+        }
+    }
+    if(points.empty()) {
+        std::cout << "No grid points with lo-freq < cent-freq < hi-freq!" << std::endl;
+        return 1;
+    }
+    std::atomic<int> nextPoint(0);
+    std::atomic<int> donePoints(0);
+    std::mutex printMtx;
+    std::vector<std::thread> workers;
+    for(int j = 0; j < jobs; j++) {
+        workers.emplace_back([&]() {
+            int p;
+            while((p = nextPoint++) < (int)points.size()) {
+                runSweepPoint(params, duration, &points[p]);
+                std::lock_guard<std::mutex> lock(printMtx);
+                std::cout << "done " << ++donePoints << " of " << points.size() << " grid points     \r" << std::flush;
+            }
+        });
+    }
+    for(size_t j = 0; j < workers.size(); j++) {
+        workers[j].join();
+    }
+    std::stable_sort(points.begin(), points.end(), isBetterPoint);
+    std::cout << std::endl;
+    std::cout << "rank  cent-freq  lo-freq  hi-freq  time-to-sync  in-sync  frames  uncertain" << std::endl;
+    for(size_t p = 0; p < points.size(); p++) {
+        std::ostringstream timeToSync;
+        if(points[p].timeToSync < 0) {
+            timeToSync << "never";
+        } else {
+            timeToSync << std::fixed << std::setprecision(1) << points[p].timeToSync << " s";
+        }
+        std::cout << std::setw(4) << p + 1 << "  " << std::setw(9) << points[p].centFreq << "  " << std::setw(7) << points[p].loFreq << "  " << std::setw(7) << points[p].hiFreq << "  " << std::setw(12) << timeToSync.str() << "  " << std::setw(6) << std::fixed << std::setprecision(1) << points[p].syncFraction * 100 << "%  " << std::setw(6) << points[p].frames << "  " << std::setw(9) << points[p].uncertainFrames << std::endl;
+    }
+    return 0;
+}
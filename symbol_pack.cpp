@@ -0,0 +1,128 @@
+#include "symbol_pack.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SYMBOL_PACK_X86
+#endif
+
+typedef void (*packKernel)(const uint8_t* in, uint8_t* out, int count);
+
+static void packSymbolsScalar(const uint8_t* symbols, uint8_t* packed, int count) {
+    for(int i = 0; i < count; i += 8) {
+        uint8_t byte = 0;
+        for(int b = 0; b < 8; b++) {
+            byte |= (symbols[i + b] != 0 ? 1 : 0) << b;
+        }
+        packed[i / 8] = byte;
+    }
+}
+
+static void unpackSymbolsScalar(const uint8_t* packed, uint8_t* symbols, int count) {
+    for(int i = 0; i < count; i++) {
+        symbols[i] = (packed[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+#ifdef SYMBOL_PACK_X86
+
+//movemask of the zero compare gives bit per symbol in the right order, x86 is little endian
+__attribute__((target("sse2")))
+static void packSymbolsSse2(const uint8_t* symbols, uint8_t* packed, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(symbols + i));
+        uint16_t bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero));
+        memcpy(packed + i / 8, &bits, 2);
+    }
+    packSymbolsScalar(symbols + i, packed + i / 8, count - i);
+}
+
+//every byte is spread to 8 lanes, lane b keeps bit b
+__attribute__((target("sse2")))
+static void unpackSymbolsSse2(const uint8_t* packed, uint8_t* symbols, int count) {
+    const __m128i bitMask = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i one = _mm_set1_epi8(1);
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        uint16_t bits;
+        memcpy(&bits, packed + i / 8, 2);
+        __m128i s = _mm_cvtsi32_si128(bits);
+        s = _mm_unpacklo_epi8(s, s);
+        s = _mm_unpacklo_epi16(s, s);
+        s = _mm_unpacklo_epi32(s, s);
+        s = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(s, bitMask), bitMask), one);
+        _mm_storeu_si128((__m128i*)(symbols + i), s);
+    }
+    unpackSymbolsScalar(packed + i / 8, symbols + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void packSymbolsAvx2(const uint8_t* symbols, uint8_t* packed, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for(; i + 32 <= count; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(symbols + i));
+        uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, zero));
+        memcpy(packed + i / 8, &bits, 4);
+    }
+    packSymbolsSse2(symbols + i, packed + i / 8, count - i);
+}
+
+__attribute__((target("avx2")))
+static void unpackSymbolsAvx2(const uint8_t* packed, uint8_t* symbols, int count) {
+    //shuffle is done inside 128 bit lanes, so the high lane takes bytes 2 and 3 of the same broadcast
+    const __m256i spread = _mm256_set_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bitMask = _mm256_set1_epi64x(0x8040201008040201LL);
+    const __m256i one = _mm256_set1_epi8(1);
+    int i = 0;
+    for(; i + 32 <= count; i += 32) {
+        uint32_t bits;
+        memcpy(&bits, packed + i / 8, 4);
+        __m256i s = _mm256_shuffle_epi8(_mm256_set1_epi32(bits), spread);
+        s = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(s, bitMask), bitMask), one);
+        _mm256_storeu_si256((__m256i*)(symbols + i), s);
+    }
+    unpackSymbolsSse2(packed + i / 8, symbols + i, count - i);
+}
+
+#endif
+
+struct symbolPackKernels {
+    const char* name;
+    packKernel pack;
+    packKernel unpack;
+};
+
+static symbolPackKernels selectKernels() {
+#ifdef SYMBOL_PACK_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        symbolPackKernels k = {"avx2", packSymbolsAvx2, unpackSymbolsAvx2};
+        return k;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        symbolPackKernels k = {"sse2", packSymbolsSse2, unpackSymbolsSse2};
+        return k;
+    }
+#endif
+    symbolPackKernels k = {"scalar", packSymbolsScalar, unpackSymbolsScalar};
+    return k;
+}
+
+static const symbolPackKernels& getKernels() {
+    static const symbolPackKernels kernels = selectKernels();
+    return kernels;
+}
+
+void packSymbols(const uint8_t* symbols, uint8_t* packed, int count) {
+    getKernels().pack(symbols, packed, count);
+}
+
+void unpackSymbols(const uint8_t* packed, uint8_t* symbols, int count) {
+    getKernels().unpack(packed, symbols, count);
+}
+
+const char* getSymbolPackKernelName() {
+    return getKernels().name;
+}
@@ -0,0 +1,13 @@
+#ifndef SYMBOL_PACK_H
+#define SYMBOL_PACK_H
+
+#include <cstdint>
+
+//packs count symbols(nonzero is 1) into count/8 bytes, symbol i goes to bit i%8 of byte i/8; count should be a multiple of 8
+void packSymbols(const uint8_t* symbols, uint8_t* packed, int count);
+//reverse of packSymbols(), symbols get 0 or 1
+void unpackSymbols(const uint8_t* packed, uint8_t* symbols, int count);
+//name of the selected pack kernel("avx2", "sse2" or "scalar")
+const char* getSymbolPackKernelName();
+
+#endif // SYMBOL_PACK_H
@@ -0,0 +1,111 @@
+#include "symbol_sender.h"
+#include <sys/socket.h>
+#include <sstream>
+#include <algorithm>
+
+SymbolSender::SymbolSender(int sockfd, int maxSize, int maxDelayMs) : maxDelay(maxDelayMs) {
+    this->sockfd = sockfd;
+    this->maxSize = maxSize;
+    waiting = false;
+    chunks = 0;
+    datagrams = 0;
+    syscalls = 0;
+}
+
+void SymbolSender::send(const uint8_t* data, int length, sockaddr_in addr) {
+    std::lock_guard<std::mutex> lock(mtx);
+    chunks++;
+    if(maxSize <= 0) {
+        sendto(sockfd, (const char *)data, length, 0, (const struct sockaddr *) &addr, sizeof(addr));
+        datagrams++;
+        syscalls++;
+        return;
+    }
+    uint64_t key = ((uint64_t)addr.sin_addr.s_addr << 16) | addr.sin_port;
+    std::map<uint64_t, pendingDatagram>::iterator it = open.find(key);
+    if(it != open.end() && (int)it->second.data.size() + length > maxSize) {
+        ready.push_back(std::move(it->second));
+        open.erase(it);
+        it = open.end();
+    }
+    if(it == open.end()) {
+        it = open.insert(std::make_pair(key, pendingDatagram())).first;
+        it->second.addr = addr;
+    }
+    it->second.data.insert(it->second.data.end(), data, data + length);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(!waiting) {
+        waiting = true;
+        firstWaiting = now;
+    }
+    if(now - firstWaiting >= maxDelay) {
+        closeOpen();
+        sendReady();
+    } else if((int)ready.size() >= BATCH_MAX_DATAGRAMS) {
+        sendReady();
+    }
+}
+
+void SymbolSender::poll() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(waiting && std::chrono::steady_clock::now() - firstWaiting >= maxDelay) {
+        closeOpen();
+        sendReady();
+    }
+}
+
+void SymbolSender::flush() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closeOpen();
+    sendReady();
+}
+
+void SymbolSender::closeOpen() {
+    for(std::map<uint64_t, pendingDatagram>::iterator it = open.begin(); it != open.end(); ++it) {
+        ready.push_back(std::move(it->second));
+    }
+    open.clear();
+    waiting = false;
+}
+
+void SymbolSender::sendReady() {
+    for(size_t start = 0; start < ready.size(); start += BATCH_MAX_DATAGRAMS) {
+        int count = std::min(ready.size() - start, (size_t)BATCH_MAX_DATAGRAMS);
+        mmsghdr msgs[BATCH_MAX_DATAGRAMS];
+        iovec iovs[BATCH_MAX_DATAGRAMS];
+        for(int i = 0; i < count; i++) {
+            pendingDatagram& d = ready[start + i];
+            iovs[i].iov_base = d.data.data();
+            iovs[i].iov_len = d.data.size();
+            msgs[i].msg_hdr.msg_name = &d.addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(d.addr);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = nullptr;
+            msgs[i].msg_hdr.msg_controllen = 0;
+            msgs[i].msg_hdr.msg_flags = 0;
+        }
+        //datagrams not taken by the kernel are dropped like a failed sendto
+        int sent = 0;
+        while(sent < count) {
+            int res = sendmmsg(sockfd, msgs + sent, count - sent, 0);
+            syscalls++;
+            if(res <= 0) {
+                break;
+            }
+            sent += res;
+        }
+        datagrams += count;
+    }
+    ready.clear();
+}
+
+std::string SymbolSender::getStats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(maxSize <= 0) {
+        return "";
+    }
+    std::ostringstream os;
+    os << " out: " << chunks << " chunks in " << datagrams << " datagrams, " << syscalls << " sends";
+    return os.str();
+}
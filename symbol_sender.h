@@ -0,0 +1,54 @@
+#ifndef SYMBOL_SENDER_H
+#define SYMBOL_SENDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <netinet/in.h>
+
+//default --batch datagram size, under the udp limit
+#define BATCH_DEFAULT_SIZE 60000
+#define BATCH_MAX_SIZE 65507
+#define BATCH_DEFAULT_DELAY_MS 1000
+//datagrams sent by one sendmmsg, ready ones are flushed before the delay when there are so many
+#define BATCH_MAX_DATAGRAMS 64
+
+//udp output of stdc_demod: with maxSize > 0 chunks to the same address are coalesced into datagrams up to maxSize,
+//and the datagrams of all addresses are sent with one sendmmsg when the oldest chunk waits for maxDelayMs
+//chunks are only concatenated, every one keeps its own length(see tagged_symbols.h), so the receiver splits them
+//send() can be called from several threads
+class SymbolSender {
+public:
+    SymbolSender(int sockfd, int maxSize, int maxDelayMs);
+    void send(const uint8_t* data, int length, sockaddr_in addr);
+    //sends the waiting chunks if the delay has passed, should be called after every block of samples
+    void poll();
+    //sends all waiting chunks
+    void flush();
+    //chunks, datagrams and syscalls for --stats line, empty without batching
+    std::string getStats();
+private:
+    struct pendingDatagram {
+        sockaddr_in addr;
+        std::vector<uint8_t> data;
+    };
+    void closeOpen();
+    void sendReady();
+    int sockfd;
+    int maxSize;
+    std::chrono::milliseconds maxDelay;
+    std::mutex mtx;
+    //datagram being filled for every address
+    std::map<uint64_t, pendingDatagram> open;
+    std::vector<pendingDatagram> ready;
+    bool waiting;
+    std::chrono::steady_clock::time_point firstWaiting;
+    long long chunks;
+    long long datagrams;
+    long long syscalls;
+};
+
+#endif // SYMBOL_SENDER_H
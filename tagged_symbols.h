@@ -0,0 +1,149 @@
+#ifndef TAGGED_SYMBOLS_H
+#define TAGGED_SYMBOLS_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <inmarsatc_demodulator.h>
+#include "fast_demodulator.h"
+#include "symbol_pack.h"
+
+//udp datagram of stdc_demod --discover: symbols of one chunk of the carrier at freq
+//plain datagrams carry only the symbols, so the receiver tells them apart by the length
+struct TaggedSymbols {
+    //carrier frequency relative to the center of the iq input, Hz
+    int32_t freq;
+    uint8_t symbols[DEMODULATOR_SYMBOLSPERCHUNK];
+};
+
+//udp datagram of stdc_demod --packed and --soft: header followed by one chunk of symbols or soft decisions
+//packed symbols are 8 per byte, first symbol in the lowest bit(see symbol_pack.h)
+//8 bit soft decisions are signed bytes, 4 bit ones are -7..7 in two's complement nibbles, first symbol in the low nibble
+#define SYMBOLS_MAGIC "SS"
+#define SYMBOLS_VERSION 1
+//freq of the header is the carrier frequency(--discover), otherwise it's 0
+#define SYMBOLS_FLAG_TAGGED 1
+#define SYMBOLS_MAX_SIZE (sizeof(SymbolsHeader) + DEMODULATOR_SYMBOLSPERCHUNK)
+//udp limit, datagrams of stdc_demod --batch are several chunks of any format one after another
+#define SYMBOLS_MAX_DATAGRAM 65536
+
+struct SymbolsHeader {
+    char magic[2];
+    uint8_t version;
+    //1 for packed symbols, 4 or 8 for soft decisions
+    uint8_t bits;
+    uint8_t flags;
+    uint8_t reserved[3];
+    int32_t freq;
+};
+
+//-7..7, weak nonzero decisions keep their sign
+inline int quantizeSoftSymbol4(int8_t value) {
+    if(value == 0) {
+        return 0;
+    }
+    int magnitude = std::max(1, (int)std::lround(std::abs(value) * 7.0 / SOFT_SYMBOL_MAX));
+    return value > 0 ? magnitude : -magnitude;
+}
+
+//writes the header to out and returns its payload
+inline uint8_t* writeSymbolsHeader(int bits, bool tagged, int32_t freq, uint8_t* out) {
+    SymbolsHeader header;
+    memcpy(header.magic, SYMBOLS_MAGIC, 2);
+    header.version = SYMBOLS_VERSION;
+    header.bits = bits;
+    header.flags = tagged ? SYMBOLS_FLAG_TAGGED : 0;
+    memset(header.reserved, 0, sizeof(header.reserved));
+    header.freq = freq;
+    memcpy(out, &header, sizeof(header));
+    return out + sizeof(header);
+}
+
+//returns the payload length or -1 if data is not a datagram of a known version
+inline int readSymbolsHeader(const uint8_t* data, int length, SymbolsHeader* header) {
+    if(length < (int)sizeof(SymbolsHeader)) {
+        return -1;
+    }
+    memcpy(header, data, sizeof(SymbolsHeader));
+    if(memcmp(header->magic, SYMBOLS_MAGIC, 2) != 0 || header->version != SYMBOLS_VERSION) {
+        return -1;
+    }
+    return length - sizeof(SymbolsHeader);
+}
+
+//returns the length of the datagram written to out(SYMBOLS_MAX_SIZE bytes)
+inline int packHardSymbols(const uint8_t* symbols, bool tagged, int32_t freq, uint8_t* out) {
+    uint8_t* payload = writeSymbolsHeader(1, tagged, freq, out);
+    packSymbols(symbols, payload, DEMODULATOR_SYMBOLSPERCHUNK);
+    return sizeof(SymbolsHeader) + DEMODULATOR_SYMBOLSPERCHUNK / 8;
+}
+
+//returns false if data is not a packed symbols datagram of a known version
+inline bool unpackHardSymbols(const uint8_t* data, int length, SymbolsHeader* header, uint8_t* symbols) {
+    if(readSymbolsHeader(data, length, header) != DEMODULATOR_SYMBOLSPERCHUNK / 8 || header->bits != 1) {
+        return false;
+    }
+    unpackSymbols(data + sizeof(SymbolsHeader), symbols, DEMODULATOR_SYMBOLSPERCHUNK);
+    return true;
+}
+
+//returns the length of the datagram written to out(SYMBOLS_MAX_SIZE bytes)
+inline int packSoftSymbols(const SoftChunk& soft, int bits, bool tagged, int32_t freq, uint8_t* out) {
+    uint8_t* payload = writeSymbolsHeader(bits, tagged, freq, out);
+    if(bits == 8) {
+        memcpy(payload, soft.symbols, DEMODULATOR_SYMBOLSPERCHUNK);
+        return sizeof(SymbolsHeader) + DEMODULATOR_SYMBOLSPERCHUNK;
+    }
+    for(int i = 0; i < DEMODULATOR_SYMBOLSPERCHUNK; i += 2) {
+        int lo = quantizeSoftSymbol4(soft.symbols[i]);
+        int hi = quantizeSoftSymbol4(soft.symbols[i + 1]);
+        payload[i / 2] = (lo & 0x0F) | ((hi & 0x0F) << 4);
+    }
+    return sizeof(SymbolsHeader) + DEMODULATOR_SYMBOLSPERCHUNK / 2;
+}
+
+//returns false if data is not a soft datagram of a known version; soft gets the decisions scaled back to -SOFT_SYMBOL_MAX..SOFT_SYMBOL_MAX
+inline bool unpackSoftSymbols(const uint8_t* data, int length, SymbolsHeader* header, SoftChunk* soft) {
+    int payloadLength = readSymbolsHeader(data, length, header);
+    const uint8_t* payload = data + sizeof(SymbolsHeader);
+    if(header->bits == 8 && payloadLength == DEMODULATOR_SYMBOLSPERCHUNK) {
+        memcpy(soft->symbols, payload, DEMODULATOR_SYMBOLSPERCHUNK);
+        return true;
+    }
+    if(header->bits == 4 && payloadLength == DEMODULATOR_SYMBOLSPERCHUNK / 2) {
+        for(int i = 0; i < DEMODULATOR_SYMBOLSPERCHUNK; i += 2) {
+            //sign extension of the nibbles
+            int lo = (int8_t)(payload[i / 2] << 4) >> 4;
+            int hi = (int8_t)(payload[i / 2] & 0xF0) >> 4;
+            soft->symbols[i] = (int8_t)(lo * SOFT_SYMBOL_MAX / 7);
+            soft->symbols[i + 1] = (int8_t)(hi * SOFT_SYMBOL_MAX / 7);
+        }
+        return true;
+    }
+    return false;
+}
+
+//length of the chunk at the start of data(rest of the datagram), -1 if it's not a known one
+inline int getChunkLength(const uint8_t* data, int length) {
+    SymbolsHeader header;
+    if(readSymbolsHeader(data, length, &header) >= 0) {
+        if(header.bits != 1 && header.bits != 4 && header.bits != 8) {
+            return -1;
+        }
+        int payloadLength = header.bits == 1 ? DEMODULATOR_SYMBOLSPERCHUNK / 8 : (header.bits == 4 ? DEMODULATOR_SYMBOLSPERCHUNK / 2 : DEMODULATOR_SYMBOLSPERCHUNK);
+        int chunkLength = sizeof(SymbolsHeader) + payloadLength;
+        return chunkLength <= length ? chunkLength : -1;
+    }
+    //plain symbols are 0 or 1, so they never look like the header
+    if(length % DEMODULATOR_SYMBOLSPERCHUNK == 0) {
+        return DEMODULATOR_SYMBOLSPERCHUNK;
+    }
+    if(length % sizeof(TaggedSymbols) == 0) {
+        return sizeof(TaggedSymbols);
+    }
+    return -1;
+}
+
+#endif // TAGGED_SYMBOLS_H
@@ -0,0 +1,245 @@
+#include "wideband_demod.h"
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+
+ChannelDemod::ChannelDemod(int id, int channel, double freq, double channelRate, double offset, double centFreq, DemodEngine* demod, bool soft) {
+    this->id = id;
+    this->soft = soft;
+    this->channel = channel;
+    this->freq = freq;
+    this->demod.reset(demod);
+    input = new BufferSampleSource(channelRate, true);
+    SampleSource* source = new FrequencyShiftSampleSource(input, channelRate, centFreq - offset);
+    if(channelRate != DEMOD_SAMPLE_RATE) {
+        source = new ResampleSampleSource(source, DEMOD_SAMPLE_RATE);
+    }
+    chain.reset(source);
+}
+
+void ChannelDemod::process(const std::complex<double>* samples, int count, std::function<void(uint8_t*, const SoftChunk*)> output) {
+    block.assign(samples, samples + count);
+    input->setBlock(block.data(), count);
+    std::complex<double>* demodSamples;
+    int demodCount;
+    while((demodCount = chain->read(&demodSamples)) > 0) {
+        softResults.clear();
+        std::vector<inmarsatc::demodulator::Demodulator::demodulator_result> res = demod->demodulate(demodSamples, demodCount, soft ? &softResults : nullptr);
+        for(int d = 0; d < (int)res.size(); d++) {
+            output(res[d].bitsDemodulated, soft ? &softResults[d] : nullptr);
+        }
+    }
+}
+
+int ChannelDemod::getId() {
+    return id;
+}
+
+int ChannelDemod::getChannel() {
+    return channel;
+}
+
+double ChannelDemod::getFreq() {
+    return freq;
+}
+
+DemodEngine* ChannelDemod::getDemod() {
+    return demod.get();
+}
+
+ChannelBank::ChannelBank(std::map<std::string, std::string> params, double sampleRate, int channels, int jobs) : channelizer(channels), pool(jobs) {
+    this->params = params;
+    this->sampleRate = sampleRate;
+    centFreq = DEMOD_DEFAULT_CENTER_FREQ;
+    if(params.find("demodCentFreq") != params.end()) {
+        centFreq = std::atoi(params["demodCentFreq"].c_str());
+    }
+    channelUsers.assign(channels, 0);
+    nextId = 0;
+}
+
+int ChannelBank::addCarrier(double freq) {
+    DemodEngine* demod = createDemodEngine(params);
+    if(demod == nullptr) {
+        return -1;
+    }
+    double offset;
+    int channel = channelizer.getChannel(freq, sampleRate, &offset);
+    if(channelUsers[channel]++ == 0) {
+        channelizer.setActive(channel, true);
+    }
+    int id = nextId++;
+    carriers[id].reset(new ChannelDemod(id, channel, freq, getChannelRate(), offset, centFreq, demod, params.find("demodSoft") != params.end()));
+    return id;
+}
+
+void ChannelBank::removeCarrier(int id) {
+    std::map<int, std::unique_ptr<ChannelDemod>>::iterator it = carriers.find(id);
+    if(it == carriers.end()) {
+        return;
+    }
+    int channel = it->second->getChannel();
+    if(--channelUsers[channel] == 0) {
+        channelizer.setActive(channel, false);
+    }
+    carriers.erase(it);
+}
+
+void ChannelBank::process(const std::complex<double>* samples, int count, std::function<void(int, uint8_t*, const SoftChunk*)> output) {
+    int produced = channelizer.process(samples, count);
+    if(produced == 0 || carriers.empty()) {
+        return;
+    }
+    std::vector<ChannelDemod*> list;
+    for(std::map<int, std::unique_ptr<ChannelDemod>>::iterator it = carriers.begin(); it != carriers.end(); ++it) {
+        list.push_back(it->second.get());
+    }
+    pool.run(list.size(), [&](int i) {
+        ChannelDemod* carrier = list[i];
+        carrier->process(channelizer.getOutput(carrier->getChannel()), produced, [&](uint8_t* symbols, const SoftChunk* soft) {
+            output(carrier->getId(), symbols, soft);
+        });
+    });
+}
+
+std::vector<int> ChannelBank::getCarrierIds() {
+    std::vector<int> ids;
+    for(std::map<int, std::unique_ptr<ChannelDemod>>::iterator it = carriers.begin(); it != carriers.end(); ++it) {
+        ids.push_back(it->first);
+    }
+    return ids;
+}
+
+ChannelDemod* ChannelBank::getCarrier(int id) {
+    std::map<int, std::unique_ptr<ChannelDemod>>::iterator it = carriers.find(id);
+    return it == carriers.end() ? nullptr : it->second.get();
+}
+
+double ChannelBank::getChannelRate() {
+    return 2 * sampleRate / channelizer.getChannels();
+}
+
+std::string ChannelBank::getStats() {
+    std::ostringstream os;
+    for(std::map<int, std::unique_ptr<ChannelDemod>>::iterator it = carriers.begin(); it != carriers.end(); ++it) {
+        DemodEngine* demod = it->second->getDemod();
+        os << " [" << it->second->getFreq() << ": " << (demod->getIsInSync() ? "sync" : "no sync") << " " << (int)demod->getCenterFreq() << "]";
+    }
+    return os.str();
+}
+
+static bool checkChannels(int channels) {
+    if(channels < CHANNELIZER_MIN_CHANNELS || channels > CHANNELIZER_MAX_CHANNELS || (channels & (channels - 1)) != 0) {
+        std::cout << "Channel count should be power of 2 from " << CHANNELIZER_MIN_CHANNELS << " to " << CHANNELIZER_MAX_CHANNELS << "!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool runChannelizedDemod(std::map<std::string, std::string>& params, int channels, std::vector<ChannelConfig> configs, int jobs, std::function<void(int, uint8_t*, const SoftChunk*)> output, std::function<std::string()> afterBlock, bool stats) {
+    if(!checkChannels(channels)) {
+        return false;
+    }
+    std::unique_ptr<SampleSource> source(createWidebandSampleSource(params));
+    if(!source) {
+        return false;
+    }
+    double sampleRate = source->getSampleRate();
+    ChannelBank bank(params, sampleRate, channels, jobs);
+    if(bank.getChannelRate() < DEMOD_MIN_SOURCE_RATE) {
+        std::cout << "Too many channels for the input sample rate!" << std::endl;
+        return false;
+    }
+    //ids are given in order, so they are the indexes of configs
+    for(size_t i = 0; i < configs.size(); i++) {
+        if(std::fabs(configs[i].freq) >= sampleRate / 2) {
+            std::cout << "Channel frequency is out of the input band!" << std::endl;
+            return false;
+        }
+        if(bank.addCarrier(configs[i].freq) < 0) {
+            return false;
+        }
+    }
+    if(stats) {
+        std::cout << "channelizer: " << channels << " channels of " << bank.getChannelRate() << " Hz, " << configs.size() << " carriers on " << jobs << " threads" << std::endl;
+    }
+    std::complex<double>* samples;
+    int samplesRead;
+    while((samplesRead = source->read(&samples)) > 0) {
+        bank.process(samples, samplesRead, output);
+        std::string outStats = afterBlock();
+        if(stats) {
+            std::cout << bank.getStats() << source->getStats() << outStats << "     \r" << std::flush;
+        }
+    }
+    return true;
+}
+
+bool runDiscoveryDemod(std::map<std::string, std::string>& params, int channels, double thresholdDb, double timeout, int jobs, std::function<void(double, uint8_t*, const SoftChunk*)> output, std::function<std::string()> afterBlock, bool stats) {
+    if(!checkChannels(channels)) {
+        return false;
+    }
+    std::unique_ptr<SampleSource> source(createWidebandSampleSource(params));
+    if(!source) {
+        return false;
+    }
+    double sampleRate = source->getSampleRate();
+    ChannelBank bank(params, sampleRate, channels, jobs);
+    if(bank.getChannelRate() < DEMOD_MIN_SOURCE_RATE) {
+        std::cout << "Too many channels for the input sample rate!" << std::endl;
+        return false;
+    }
+    //filterbank response falls off near the band edges
+    WidebandCarrierDetector detector(sampleRate, thresholdDb, sampleRate / 2 - sampleRate / channels);
+    //sample time when every carrier was last seen in the spectrum or in sync
+    std::map<int, long long> lastSeen;
+    long long time = 0;
+    long long timeoutSamples = (long long)(timeout * sampleRate);
+    std::complex<double>* samples;
+    int samplesRead;
+    while((samplesRead = source->read(&samples)) > 0) {
+        time += samplesRead;
+        if(detector.process(samples, samplesRead)) {
+            std::vector<double> found = detector.getCarriers();
+            std::vector<int> ids = bank.getCarrierIds();
+            for(size_t f = 0; f < found.size(); f++) {
+                bool known = false;
+                for(size_t c = 0; c < ids.size(); c++) {
+                    if(std::fabs(bank.getCarrier(ids[c])->getFreq() - found[f]) < DISCOVERY_MATCH_FREQ) {
+                        lastSeen[ids[c]] = time;
+                        known = true;
+                    }
+                }
+                if(known || (int)lastSeen.size() >= DISCOVERY_MAX_CARRIERS) {
+                    continue;
+                }
+                int id = bank.addCarrier(std::round(found[f]));
+                if(id < 0) {
+                    return false;
+                }
+                lastSeen[id] = time;
+                ids.push_back(id);
+                std::cout << "carrier at " << std::round(found[f]) << " Hz appeared" << std::endl;
+            }
+            for(size_t c = 0; c < ids.size(); c++) {
+                ChannelDemod* carrier = bank.getCarrier(ids[c]);
+                if(carrier->getDemod()->getIsInSync()) {
+                    lastSeen[ids[c]] = time;
+                } else if(time - lastSeen[ids[c]] > timeoutSamples) {
+                    std::cout << "carrier at " << carrier->getFreq() << " Hz retired" << std::endl;
+                    lastSeen.erase(ids[c]);
+                    bank.removeCarrier(ids[c]);
+                }
+            }
+        }
+        bank.process(samples, samplesRead, [&](int id, uint8_t* symbols, const SoftChunk* soft) {
+            output(bank.getCarrier(id)->getFreq(), symbols, soft);
+        });
+        std::string outStats = afterBlock();
+        if(stats) {
+            std::cout << lastSeen.size() << " carriers" << bank.getStats() << source->getStats() << outStats << "     \r" << std::flush;
+        }
+    }
+    return true;
+}
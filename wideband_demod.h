@@ -0,0 +1,89 @@
+#ifndef WIDEBAND_DEMOD_H
+#define WIDEBAND_DEMOD_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sample_frontend.h"
+#include "demod_engine.h"
+#include "channelizer.h"
+#include "worker_pool.h"
+#include "acquisition.h"
+
+//discovered carriers closer than this to a running one are taken as the same carrier
+#define DISCOVERY_MATCH_FREQ 1000
+#define DISCOVERY_MAX_CARRIERS 64
+//carrier is retired after it isn't seen in the spectrum and its demodulator is out of sync for this time
+#define DISCOVERY_DEFAULT_TIMEOUT 30
+
+//carrier selected with --channel
+struct ChannelConfig {
+    //offset from the center of the iq input, Hz
+    double freq;
+    int port;
+};
+
+//one carrier: its channelizer output is moved to the demodulator band, resampled to 48k and demodulated
+class ChannelDemod {
+public:
+    //offset is the carrier frequency relative to the channel center; takes ownership of demod
+    ChannelDemod(int id, int channel, double freq, double channelRate, double offset, double centFreq, DemodEngine* demod, bool soft);
+    //demodulates the next block of the channel; output gets every chunk of symbols and its soft decisions(nullptr if soft is off)
+    void process(const std::complex<double>* samples, int count, std::function<void(uint8_t*, const SoftChunk*)> output);
+    int getId();
+    int getChannel();
+    double getFreq();
+    DemodEngine* getDemod();
+private:
+    int id;
+    int channel;
+    double freq;
+    BufferSampleSource* input;
+    std::unique_ptr<SampleSource> chain;
+    std::unique_ptr<DemodEngine> demod;
+    bool soft;
+    std::vector<SoftChunk> softResults;
+    //own copy of the channel, carriers sharing the channel are shifted differently
+    std::vector<std::complex<double>> block;
+};
+
+//channelizer with a demodulator per carrier, carriers are demodulated in parallel by the pool
+//cpu and memory depend on the count of carriers, not on the count of channels
+class ChannelBank {
+public:
+    ChannelBank(std::map<std::string, std::string> params, double sampleRate, int channels, int jobs);
+    //starts demodulating the carrier at freq(relative to the input center); returns its id or -1 if the engine can't be created
+    int addCarrier(double freq);
+    void removeCarrier(int id);
+    //output gets id of the carrier, its symbols and soft decisions(with demodSoft param only)
+    void process(const std::complex<double>* samples, int count, std::function<void(int, uint8_t*, const SoftChunk*)> output);
+    std::vector<int> getCarrierIds();
+    ChannelDemod* getCarrier(int id);
+    double getChannelRate();
+    //frequency and sync of every carrier for --stats line
+    std::string getStats();
+private:
+    std::map<std::string, std::string> params;
+    double sampleRate;
+    double centFreq;
+    Channelizer channelizer;
+    WorkerPool pool;
+    std::map<int, std::unique_ptr<ChannelDemod>> carriers;
+    //count of carriers using each channel
+    std::vector<int> channelUsers;
+    int nextId;
+};
+
+//demodulates carriers of the wideband iq source selected in params with one channelizer of channels channels and a demodulator per carrier on jobs threads
+//output gets index of the carrier in configs and its symbols; returns false on source or engine error
+//afterBlock is called when all chunks of the input block are out, its result is appended to the --stats line
+bool runChannelizedDemod(std::map<std::string, std::string>& params, int channels, std::vector<ChannelConfig> configs, int jobs, std::function<void(int, uint8_t*, const SoftChunk*)> output, std::function<std::string()> afterBlock, bool stats);
+
+//same as runChannelizedDemod, but the carriers are found in the spectrum of the input: demodulator is started for every new carrier and retired after timeout seconds without it
+//output gets frequency of the carrier and its symbols
+bool runDiscoveryDemod(std::map<std::string, std::string>& params, int channels, double thresholdDb, double timeout, int jobs, std::function<void(double, uint8_t*, const SoftChunk*)> output, std::function<std::string()> afterBlock, bool stats);
+
+#endif // WIDEBAND_DEMOD_H
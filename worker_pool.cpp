@@ -0,0 +1,81 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(int threads) {
+    tasks = 0;
+    nextTask = 0;
+    doneTasks = 0;
+    generation = 0;
+    stopping = false;
+    for(int i = 1; i < threads; i++) {
+        this->threads.emplace_back(&WorkerPool::worker, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    startCond.notify_all();
+    for(size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void WorkerPool::run(int tasks, std::function<void(int)> task) {
+    if(tasks <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->task = task;
+        this->tasks = tasks;
+        nextTask = 0;
+        doneTasks = 0;
+        generation++;
+    }
+    //a single task is not worth waking anybody up
+    if(tasks > 1) {
+        startCond.notify_all();
+    }
+    runTasks();
+    std::unique_lock<std::mutex> lock(mtx);
+    doneCond.wait(lock, [&]() { return doneTasks == this->tasks; });
+}
+
+int WorkerPool::getThreads() {
+    return threads.size() + 1;
+}
+
+void WorkerPool::runTasks() {
+    while(true) {
+        int index;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(nextTask >= tasks) {
+                return;
+            }
+            index = nextTask++;
+        }
+        task(index);
+        std::lock_guard<std::mutex> lock(mtx);
+        if(++doneTasks == tasks) {
+            doneCond.notify_all();
+        }
+    }
+}
+
+void WorkerPool::worker() {
+    long long seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            startCond.wait(lock, [&]() { return stopping || generation != seen; });
+            if(stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        runTasks();
+    }
+}
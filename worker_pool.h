@@ -0,0 +1,34 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//persistent threads running independent tasks of one step in parallel, the caller thread takes part too
+class WorkerPool {
+public:
+    //threads is the total count including the caller
+    WorkerPool(int threads);
+    ~WorkerPool();
+    //runs task(0..tasks-1) and returns when all of them are done
+    void run(int tasks, std::function<void(int)> task);
+    int getThreads();
+private:
+    void worker();
+    void runTasks();
+    std::vector<std::thread> threads;
+    std::mutex mtx;
+    std::condition_variable startCond;
+    std::condition_variable doneCond;
+    std::function<void(int)> task;
+    int tasks;
+    int nextTask;
+    int doneTasks;
+    long long generation;
+    bool stopping;
+};
+
+#endif // WORKER_POOL_H